@@ -38,10 +38,12 @@
 #define UBR1_GAZEBO_CONTROLLER_MANAGER_H_
 
 #include <ros/ros.h>
+#include <boost/scoped_array.hpp>
 
 #include <ubr_controllers/controller.h>
 #include <ubr_controllers/controller_manager.h>
 #include <ubr1_gazebo/joint_handle.h>
+#include <ubr1_gazebo/joint_servo.h>
 #include <gazebo/gazebo.hh>
 #include <gazebo/physics/physics.hh>
 
@@ -51,15 +53,33 @@ namespace ubr1_gazebo
 class GazeboControllerManager : public ubr_controllers::ControllerManager
 {
 public:
-  GazeboControllerManager(gazebo::physics::ModelPtr robot) : nh_("~"), robot_(robot)
+  /**
+   *  \brief Create a manager for a robot model.
+   *  \param robot The Gazebo model.
+   *  \param root_nh Namespace to load controllers relative to.
+   *  \param nh Namespace with list of controllers and joint parameters.
+   */
+  GazeboControllerManager(gazebo::physics::ModelPtr robot,
+                          const ros::NodeHandle& root_nh,
+                          const ros::NodeHandle& nh) :
+    ubr_controllers::ControllerManager(root_nh),
+    nh_(nh),
+    robot_(robot)
   {
     this->joints_ = robot->GetJoints();
-
-    for (gazebo::physics::Joint_V::iterator it = this->joints_.begin(); it != this->joints_.end(); ++it)
+    this->servo_.reset(new JointServoBatch(this->joints_, nh_));
+
+    /*
+     * Handles are stored by value in one array in joint order, the map is
+     * only used for lookup by name. The array is never reallocated, so
+     * pointers returned by getJointHandle() stay valid for the life of
+     * the manager.
+     */
+    this->handles_.reset(new GazeboJointHandle[this->joints_.size()]);
+    for (size_t i = 0; i < this->joints_.size(); ++i)
     {
-      boost::shared_ptr<GazeboJointHandle> jh;
-      jh.reset(new GazeboJointHandle(*it));
-      this->jointMap_[(*it)->GetName()] = jh;
+      this->handles_[i].attach(this->servo_.get(), i);
+      this->jointMap_[this->joints_[i]->GetName()] = i;
     }
 
     init(nh_);
@@ -71,27 +91,20 @@ public:
   virtual bool init(ros::NodeHandle & nh)
   {
     // Load default controllers
-    ubr_controllers::ControllerManager::init(nh);
+    return ubr_controllers::ControllerManager::init(nh);
   }
 
   virtual bool update(const ros::Time now, const ros::Duration dt)
   {
-    // Clear previous commands
-    for (std::map<std::string, boost::shared_ptr<GazeboJointHandle> >::const_iterator it = this->jointMap_.begin();
-             it != this->jointMap_.end(); ++it)
-    {
-      it->second->clear();
-    }
+    // Get joint states, clear previous commands
+    this->servo_->read();
+    this->servo_->clear();
 
     // Add controller updates
     ControllerManager::update(now, dt);
 
-    // Set commands in Gazebo
-    for (std::map<std::string, boost::shared_ptr<GazeboJointHandle> >::const_iterator it = this->jointMap_.begin();
-             it != this->jointMap_.end(); ++it)
-    {
-      it->second->update(now, dt);
-    }
+    // Run servo loop for all joints, set commands in Gazebo
+    this->servo_->update(dt);
 
     return true;
   }
@@ -101,9 +114,9 @@ public:
    */
   virtual ubr_controllers::JointHandle* getJointHandle(const std::string& name)
   {
-    std::map<std::string, boost::shared_ptr<GazeboJointHandle> >::iterator it = this->jointMap_.find(name);
+    std::map<std::string, size_t>::iterator it = this->jointMap_.find(name);
     if (it != this->jointMap_.end())
-      return it->second.get();
+      return &this->handles_[it->second];
     else
     {
       ROS_ERROR("Did not find joint [%s]", name.c_str());
@@ -115,7 +128,9 @@ private:
   ros::NodeHandle nh_;
   gazebo::physics::ModelPtr robot_;
   gazebo::physics::Joint_V joints_;
-  std::map<std::string, boost::shared_ptr<GazeboJointHandle> > jointMap_;
+  boost::shared_ptr<JointServoBatch> servo_;
+  boost::scoped_array<GazeboJointHandle> handles_;
+  std::map<std::string, size_t> jointMap_;
 };
 
 }  // namespace ubr1_gazebo
@@ -38,52 +38,43 @@
 #define UBR1_GAZEBO_JOINT_HANDLE_H_
 
 #include <ros/ros.h>
-#include <angles/angles.h>
 
-#include <gazebo/physics/physics.hh>
 #include <ubr_controllers/joint_handle.h>
-#include <control_toolbox/pid.h>
+#include <ubr1_gazebo/joint_servo.h>
 
 namespace ubr1_gazebo
 {
 
-enum CommandState
-{
-  MODE_DISABLED,
-  MODE_CONTROL_EFFORT,
-  MODE_CONTROL_VELOCITY,
-  MODE_CONTROL_POSITION
-};
-
+/**
+ *  \brief Handle to a single joint in a JointServoBatch.
+ */
 class GazeboJointHandle : public ubr_controllers::JointHandle
 {
 public:
-  GazeboJointHandle(gazebo::physics::JointPtr joint_ptr) :
-    joint_(joint_ptr),
-    mode_(MODE_DISABLED)
+  GazeboJointHandle() :
+    batch_(NULL),
+    index_(0)
+  {
+  }
+  GazeboJointHandle(JointServoBatch* batch, size_t index) :
+    batch_(batch),
+    index_(index)
   {
-    ros::NodeHandle nh("~");
-
-    // Load controller parameters
-    position_pid_.init(ros::NodeHandle(nh, getName() + "/position"));
-    velocity_pid_.init(ros::NodeHandle(nh, getName() + "/velocity"));
-
-    // Load optional effort_limit as a workaround to gzsdf limitation
-    nh.param(getName() + "/effort_limit", effort_limit_, -1.0);
-
-    // Extra force input (for torso gas spring)
-    nh.param(getName() + "/effort_offset", effort_offset_, 0.0);
-
-    // Should we put out debug info?
-    nh.param(getName() + "/debug", debug_, false);
-
-    if (debug_)
-      ROS_INFO_STREAM(getName() << " has limit of " << getEffortLimit() << " and offset of " << effort_offset_);
   }
   virtual ~GazeboJointHandle()
   {
   }
 
+  /**
+   *  \brief Point a default constructed handle at a joint, used when
+   *         handles are allocated as an array.
+   */
+  void attach(JointServoBatch* batch, size_t index)
+  {
+    batch_ = batch;
+    index_ = index;
+  }
+
   /**
    *  \brief Used by controllers to set the desired position command of a joint.
    *  \param position The desired position, in radians or meters.
@@ -98,16 +89,16 @@ public:
   {
     if (update)
     {
-      desired_position_ += position;
-      desired_velocity_ += velocity;
-      desired_effort_ += effort;
-      mode_ = MODE_CONTROL_POSITION;
+      batch_->desired_position_[index_] += position;
+      batch_->desired_velocity_[index_] += velocity;
+      batch_->desired_effort_[index_] += effort;
+      batch_->mode_[index_] = MODE_CONTROL_POSITION;
       return true;
     }
-    desired_position_ = position;
-    desired_velocity_ = velocity;
-    desired_effort_ = effort;
-    mode_ = MODE_CONTROL_POSITION;
+    batch_->desired_position_[index_] = position;
+    batch_->desired_velocity_[index_] = velocity;
+    batch_->desired_effort_[index_] = effort;
+    batch_->mode_[index_] = MODE_CONTROL_POSITION;
     return true;
   }
 
@@ -123,20 +114,15 @@ public:
   {
     if (update)
     {
-      if (isPositionControlled())
-      {
-        desired_velocity_ += velocity;
-        desired_effort_ += effort;
-        return true;
-      }
-      desired_velocity_ += velocity;
-      desired_effort_ += effort;
-      mode_ = MODE_CONTROL_VELOCITY;
+      batch_->desired_velocity_[index_] += velocity;
+      batch_->desired_effort_[index_] += effort;
+      if (!isPositionControlled())
+        batch_->mode_[index_] = MODE_CONTROL_VELOCITY;
       return true;
     }
-    desired_velocity_ = velocity;
-    desired_effort_ = effort;
-    mode_ = MODE_CONTROL_VELOCITY;
+    batch_->desired_velocity_[index_] = velocity;
+    batch_->desired_effort_[index_] = effort;
+    batch_->mode_[index_] = MODE_CONTROL_VELOCITY;
     return true;
   }
 
@@ -148,174 +134,89 @@ public:
   virtual bool setEffortCommand(const float effort,
                                 bool update = false)
   {
-    if (update)
+    if (update && (isPositionControlled() || isVelocityControlled()))
     {
-      if (isPositionControlled())
-      {
-        desired_effort_ += effort;
-        return true;
-      }
-      else if (isVelocityControlled())
-      {
-        desired_effort_ += effort;
-        return true;
-      }
-      else
-      {
-        desired_effort_ = effort;
-        mode_ = MODE_CONTROL_EFFORT;
-        return true;
-      }
+      batch_->desired_effort_[index_] += effort;
+      return true;
     }
-    desired_effort_ = effort;
-    mode_ = MODE_CONTROL_EFFORT;
+    batch_->desired_effort_[index_] = effort;
+    batch_->mode_[index_] = MODE_CONTROL_EFFORT;
     return true;
   }
 
   /** \brief Returns the position of the joint. */
   virtual double getPosition()
   {
-    return joint_->GetAngle(0).Radian();
+    return batch_->position_[index_];
   }
 
   /** \brief Returns the velocity of the joint. */
   virtual double getVelocity()
   {
-    return joint_->GetVelocity(0);
+    return batch_->velocity_[index_];
   }
 
   /** \brief Returns the effort applied to the joint. */
   virtual double getEffort()
   {
-    return applied_effort_;
+    return batch_->applied_effort_[index_];
   }
 
   /** \brief Get the lower positional limit */
   virtual float getPositionLowerLimit()
   {
-    return joint_->GetLowerLimit(0).Radian();
+    return batch_->joints_[index_]->GetLowerLimit(0).Radian();
   }
 
   /** \brief Get the upper positional limit */
   virtual float getPositionUpperLimit()
   {
-    return joint_->GetUpperLimit(0).Radian();
+    return batch_->joints_[index_]->GetUpperLimit(0).Radian();
   }
 
   /** \brief Get the velocity limit */
   virtual float getVelocityLimit()
   {
-    return joint_->GetVelocityLimit(0);
+    return batch_->joints_[index_]->GetVelocityLimit(0);
   }
 
   /** \brief Get the effort limit */
   virtual float getEffortLimit()
   {
-    /*
-     * gzsdf has a major flaw when using continuous joints. It appears gazebo
-     * cannot handle continuous joints and so it sets the limits to +/-1e16.
-     * This is fine, except it drops the limit effort and limit velocity.
-     * Lack of limit effort causes the robot to implode to the origin if the
-     * controllers are not tuned or experience a disturbance. This little hack
-     * lets us limit the controller effort internally.
-     */
-    if (effort_limit_ < 0.0)
-      return joint_->GetEffortLimit(0);
-    else
-      return effort_limit_;
+    return batch_->effort_limit_[index_];
   }
 
   virtual std::string getName()
   {
-    // TODO pointer check on joint_ ???
-    return joint_->GetName();
-  }
-
-  void clear()
-  {
-    desired_position_ = 0.0;
-    desired_velocity_ = 0.0;
-    desired_effort_ = 0.0;
-    mode_ = MODE_DISABLED;
+    return batch_->names_[index_];
   }
 
   bool isPositionControlled()
   {
-    return mode_ == MODE_CONTROL_POSITION;
+    return batch_->mode_[index_] == MODE_CONTROL_POSITION;
   }
 
   bool isVelocityControlled()
   {
-    return mode_ == MODE_CONTROL_VELOCITY;
+    return batch_->mode_[index_] == MODE_CONTROL_VELOCITY;
   }
 
   bool isEffortControlled()
   {
-    return mode_ == MODE_CONTROL_EFFORT;
-  }
-
-  void update(const ros::Time now, const ros::Duration dt)
-  {
-    float effort = 0.0;
-    if (isEffortControlled())
-    {
-      effort = desired_effort_;
-    }
-    else if (isPositionControlled())
-    {
-      float p_error = angles::shortest_angular_distance(getPosition(), desired_position_);
-      float t = position_pid_.computeCommand(p_error, dt) +
-                velocity_pid_.computeCommand(desired_velocity_ - getVelocity(), dt);
-      effort = t + desired_effort_;
-    }
-    else if (isVelocityControlled())
-    {
-      float t = velocity_pid_.computeCommand(desired_velocity_ - getVelocity(), dt);
-      effort = t + desired_effort_;
-    }
-
-    // Limit effort so robot doesn't implode
-    float lim = getEffortLimit();
-    applied_effort_ = std::max(-lim, std::min(effort, lim));
-
-    if (debug_)
-      ROS_INFO_STREAM(getName() << " commanded effort of " << effort);
-
-    // Actually update
-    joint_->SetForce(0, applied_effort_ + effort_offset_);
+    return batch_->mode_[index_] == MODE_CONTROL_EFFORT;
   }
 
   /** \brief Used only by the gripper */
   double setMaxEffort(double effort)
   {
-    effort_limit_ = effort;
+    batch_->effort_limit_param_[index_] = effort;
+    batch_->updateEffortLimit(index_);
     return getEffortLimit();
   }
 
 private:
-  gazebo::physics::JointPtr joint_;
-
-  float desired_position_;
-  float desired_velocity_;
-  float desired_effort_;
-  
-  /// control mode
-  int mode_;
-
-  control_toolbox::Pid position_pid_;
-  control_toolbox::Pid velocity_pid_;
-
-  /// Hack for continuous joints that fail to have effort limits
-  double effort_limit_;
-
-  /// Hack for joints with gas springs attached
-  double effort_offset_;
-
-  /// GetForce(0u) is not always right
-  double applied_effort_;
-
-  /// By-joint debug capability
-  bool debug_;
+  JointServoBatch* batch_;
+  size_t index_;
 
   // You no copy...
   GazeboJointHandle(const GazeboJointHandle&);
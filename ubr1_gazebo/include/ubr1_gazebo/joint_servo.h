@@ -0,0 +1,236 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Michael Ferguson */
+
+#ifndef UBR1_GAZEBO_JOINT_SERVO_H_
+#define UBR1_GAZEBO_JOINT_SERVO_H_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <angles/angles.h>
+
+#include <gazebo/physics/physics.hh>
+#include <ubr1_gazebo/pid_batch.h>
+
+namespace ubr1_gazebo
+{
+
+enum CommandState
+{
+  MODE_DISABLED,
+  MODE_CONTROL_EFFORT,
+  MODE_CONTROL_VELOCITY,
+  MODE_CONTROL_POSITION
+};
+
+/**
+ *  \brief Servo state for all simulated joints of a model, stored as
+ *         parallel arrays indexed by joint. GazeboJointHandles are thin
+ *         views into this structure, the controller manager runs the
+ *         PID, clamping and effort offsets for all joints in one pass.
+ */
+class JointServoBatch
+{
+  friend class GazeboJointHandle;
+
+public:
+  JointServoBatch(const gazebo::physics::Joint_V& joints, ros::NodeHandle nh) :
+    joints_(joints)
+  {
+    size_t n = joints_.size();
+    names_.resize(n);
+    position_.resize(n, 0.0);
+    velocity_.resize(n, 0.0);
+    mode_.resize(n, MODE_DISABLED);
+    desired_position_.resize(n, 0.0);
+    desired_velocity_.resize(n, 0.0);
+    desired_effort_.resize(n, 0.0);
+    commanded_effort_.resize(n, 0.0);
+    applied_effort_.resize(n, 0.0);
+    effort_limit_param_.resize(n, -1.0);
+    effort_limit_.resize(n, 0.0);
+    effort_offset_.resize(n, 0.0);
+    debug_.resize(n, false);
+    position_pid_.resize(n);
+    velocity_pid_.resize(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      names_[i] = joints_[i]->GetName();
+
+      // Load controller parameters
+      position_pid_.init(i, ros::NodeHandle(nh, names_[i] + "/position"));
+      velocity_pid_.init(i, ros::NodeHandle(nh, names_[i] + "/velocity"));
+
+      // Load optional effort_limit as a workaround to gzsdf limitation
+      nh.param(names_[i] + "/effort_limit", effort_limit_param_[i], -1.0);
+      updateEffortLimit(i);
+
+      // Extra force input (for torso gas spring)
+      nh.param(names_[i] + "/effort_offset", effort_offset_[i], 0.0);
+
+      // Should we put out debug info?
+      bool debug;
+      nh.param(names_[i] + "/debug", debug, false);
+      debug_[i] = debug;
+
+      if (debug_[i])
+        ROS_INFO_STREAM(names_[i] << " has limit of " << effort_limit_[i] << " and offset of " << effort_offset_[i]);
+    }
+
+    read();
+  }
+
+  /** \brief Number of joints in the batch. */
+  size_t size() const
+  {
+    return joints_.size();
+  }
+
+  /** \brief Refresh position and velocity of all joints from Gazebo. */
+  void read()
+  {
+    for (size_t i = 0; i < joints_.size(); ++i)
+    {
+      position_[i] = joints_[i]->GetAngle(0).Radian();
+      velocity_[i] = joints_[i]->GetVelocity(0);
+    }
+  }
+
+  /** \brief Clear previous commands of all joints. */
+  void clear()
+  {
+    std::fill(mode_.begin(), mode_.end(), static_cast<int>(MODE_DISABLED));
+    std::fill(desired_position_.begin(), desired_position_.end(), 0.0f);
+    std::fill(desired_velocity_.begin(), desired_velocity_.end(), 0.0f);
+    std::fill(desired_effort_.begin(), desired_effort_.end(), 0.0f);
+  }
+
+  /** \brief Compute efforts for all joints, and apply them in Gazebo. */
+  void update(const ros::Duration dt)
+  {
+    double dt_s = dt.toSec();
+    size_t n = joints_.size();
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      float effort = desired_effort_[i];
+      if (mode_[i] == MODE_CONTROL_POSITION)
+      {
+        float p_error = angles::shortest_angular_distance(position_[i], desired_position_[i]);
+        effort += position_pid_.compute(i, p_error, dt_s) +
+                  velocity_pid_.compute(i, desired_velocity_[i] - velocity_[i], dt_s);
+      }
+      else if (mode_[i] == MODE_CONTROL_VELOCITY)
+      {
+        effort += velocity_pid_.compute(i, desired_velocity_[i] - velocity_[i], dt_s);
+      }
+      else if (mode_[i] == MODE_DISABLED)
+      {
+        effort = 0.0;
+      }
+
+      // Limit effort so robot doesn't implode
+      commanded_effort_[i] = effort;
+      float lim = effort_limit_[i];
+      applied_effort_[i] = std::max(-lim, std::min(effort, lim));
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (debug_[i])
+        ROS_INFO_STREAM(names_[i] << " commanded effort of " << commanded_effort_[i]);
+
+      // Actually update
+      joints_[i]->SetForce(0, applied_effort_[i] + effort_offset_[i]);
+    }
+  }
+
+private:
+  /*
+   * gzsdf has a major flaw when using continuous joints. It appears gazebo
+   * cannot handle continuous joints and so it sets the limits to +/-1e16.
+   * This is fine, except it drops the limit effort and limit velocity.
+   * Lack of limit effort causes the robot to implode to the origin if the
+   * controllers are not tuned or experience a disturbance. This little hack
+   * lets us limit the controller effort internally.
+   */
+  void updateEffortLimit(size_t i)
+  {
+    if (effort_limit_param_[i] < 0.0)
+      effort_limit_[i] = joints_[i]->GetEffortLimit(0);
+    else
+      effort_limit_[i] = effort_limit_param_[i];
+  }
+
+  gazebo::physics::Joint_V joints_;
+  std::vector<std::string> names_;
+
+  /// Joint state, refreshed by read()
+  std::vector<double> position_;
+  std::vector<double> velocity_;
+
+  /// Commands, cleared each cycle
+  std::vector<int> mode_;
+  std::vector<float> desired_position_;
+  std::vector<float> desired_velocity_;
+  std::vector<float> desired_effort_;
+
+  /// Effort from the controllers, before limiting, for debugging
+  std::vector<float> commanded_effort_;
+  /// GetForce(0u) is not always right
+  std::vector<float> applied_effort_;
+
+  /// Hack for continuous joints that fail to have effort limits
+  std::vector<double> effort_limit_param_;
+  /// Cached effective effort limit
+  std::vector<float> effort_limit_;
+
+  /// Hack for joints with gas springs attached
+  std::vector<double> effort_offset_;
+
+  /// By-joint debug capability
+  std::vector<bool> debug_;
+
+  PidBatch position_pid_;
+  PidBatch velocity_pid_;
+};
+
+}  // namespace ubr1_gazebo
+
+#endif  // UBR1_GAZEBO_JOINT_SERVO_H_
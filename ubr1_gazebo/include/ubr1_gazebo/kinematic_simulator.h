@@ -0,0 +1,338 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Michael Ferguson */
+
+#ifndef UBR1_GAZEBO_KINEMATIC_SIMULATOR_H_
+#define UBR1_GAZEBO_KINEMATIC_SIMULATOR_H_
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include <ros/ros.h>
+#include <urdf/model.h>
+
+#include <ubr_controllers/controller.h>
+#include <ubr_controllers/controller_manager.h>
+#include <ubr_controllers/joint_handle.h>
+
+namespace ubr1_gazebo
+{
+
+/**
+ *  \brief Joint handle which models the joint as a critically damped (by
+ *         default) second-order system tracking the commanded position or
+ *         velocity. There is no contact, gravity or effort simulation,
+ *         effort-controlled and disabled joints decelerate to rest.
+ */
+class KinematicJointHandle : public ubr_controllers::JointHandle
+{
+  enum CommandState
+  {
+    MODE_DISABLED,
+    MODE_CONTROL_EFFORT,
+    MODE_CONTROL_VELOCITY,
+    MODE_CONTROL_POSITION
+  };
+
+public:
+  KinematicJointHandle(boost::shared_ptr<const urdf::Joint> joint, ros::NodeHandle nh) :
+    name_(joint->name),
+    position_(0.0),
+    velocity_(0.0),
+    effort_(0.0),
+    lower_(0.0),
+    upper_(0.0),
+    has_position_limits_(false),
+    velocity_limit_(0.0),
+    effort_limit_(0.0)
+  {
+    if (joint->limits)
+    {
+      has_position_limits_ = (joint->type != urdf::Joint::CONTINUOUS);
+      lower_ = joint->limits->lower;
+      upper_ = joint->limits->upper;
+      velocity_limit_ = joint->limits->velocity;
+      effort_limit_ = joint->limits->effort;
+    }
+
+    // Natural frequency and damping ratio of the simulated joint
+    double omega, zeta;
+    nh.param("omega", omega, 30.0);
+    nh.param("zeta", zeta, 1.0);
+    nh.param(name_ + "/kinematic/omega", omega, omega);
+    nh.param(name_ + "/kinematic/zeta", zeta, zeta);
+    nh.param(name_ + "/kinematic/max_acceleration", max_acceleration_, 50.0);
+    kp_ = omega * omega;
+    kd_ = 2.0 * zeta * omega;
+
+    // Start in the middle of the limits, if there are any
+    if (has_position_limits_ && (lower_ > 0.0 || upper_ < 0.0))
+      position_ = (lower_ + upper_) / 2.0;
+
+    clear();
+  }
+  virtual ~KinematicJointHandle()
+  {
+  }
+
+  virtual bool setPositionCommand(const float position,
+                                  const float velocity,
+                                  const float effort,
+                                  bool update = false)
+  {
+    if (update)
+    {
+      desired_position_ += position;
+      desired_velocity_ += velocity;
+      desired_effort_ += effort;
+    }
+    else
+    {
+      desired_position_ = position;
+      desired_velocity_ = velocity;
+      desired_effort_ = effort;
+    }
+    mode_ = MODE_CONTROL_POSITION;
+    return true;
+  }
+
+  virtual bool setVelocityCommand(const float velocity,
+                                  const float effort,
+                                  bool update = false)
+  {
+    if (update)
+    {
+      desired_velocity_ += velocity;
+      desired_effort_ += effort;
+      if (mode_ != MODE_CONTROL_POSITION)
+        mode_ = MODE_CONTROL_VELOCITY;
+      return true;
+    }
+    desired_velocity_ = velocity;
+    desired_effort_ = effort;
+    mode_ = MODE_CONTROL_VELOCITY;
+    return true;
+  }
+
+  virtual bool setEffortCommand(const float effort,
+                                bool update = false)
+  {
+    if (update && (mode_ == MODE_CONTROL_POSITION || mode_ == MODE_CONTROL_VELOCITY))
+    {
+      desired_effort_ += effort;
+      return true;
+    }
+    desired_effort_ = effort;
+    mode_ = MODE_CONTROL_EFFORT;
+    return true;
+  }
+
+  /** \brief Returns the position of the joint. */
+  virtual double getPosition() { return position_; }
+
+  /** \brief Returns the velocity of the joint. */
+  virtual double getVelocity() { return velocity_; }
+
+  /** \brief Returns the commanded effort of the joint. */
+  virtual double getEffort() { return effort_; }
+
+  /** \brief Get the lower positional limit */
+  virtual float getPositionLowerLimit() { return lower_; }
+
+  /** \brief Get the upper positional limit */
+  virtual float getPositionUpperLimit() { return upper_; }
+
+  /** \brief Get the velocity limit */
+  virtual float getVelocityLimit() { return velocity_limit_; }
+
+  /** \brief Get the effort limit */
+  virtual float getEffortLimit() { return effort_limit_; }
+
+  virtual std::string getName() { return name_; }
+
+  void clear()
+  {
+    desired_position_ = 0.0;
+    desired_velocity_ = 0.0;
+    desired_effort_ = 0.0;
+    mode_ = MODE_DISABLED;
+  }
+
+  /** \brief Integrate the joint forward by dt seconds. */
+  void update(const double dt)
+  {
+    double acceleration;
+    if (mode_ == MODE_CONTROL_POSITION)
+      acceleration = kp_ * (desired_position_ - position_) + kd_ * (desired_velocity_ - velocity_);
+    else if (mode_ == MODE_CONTROL_VELOCITY)
+      acceleration = kd_ * (desired_velocity_ - velocity_);
+    else
+      acceleration = -kd_ * velocity_;
+    effort_ = desired_effort_;
+
+    acceleration = std::max(-max_acceleration_, std::min(acceleration, max_acceleration_));
+
+    // Semi-implicit Euler, stable for the stiffness we care about
+    velocity_ += acceleration * dt;
+    if (velocity_limit_ > 0.0)
+      velocity_ = std::max(-velocity_limit_, std::min(velocity_, velocity_limit_));
+    position_ += velocity_ * dt;
+
+    if (has_position_limits_)
+    {
+      if (position_ < lower_)
+      {
+        position_ = lower_;
+        velocity_ = std::max(0.0, velocity_);
+      }
+      else if (position_ > upper_)
+      {
+        position_ = upper_;
+        velocity_ = std::min(0.0, velocity_);
+      }
+    }
+  }
+
+private:
+  std::string name_;
+
+  double position_;
+  double velocity_;
+  double effort_;
+
+  float desired_position_;
+  float desired_velocity_;
+  float desired_effort_;
+  int mode_;
+
+  double lower_;
+  double upper_;
+  bool has_position_limits_;
+  double velocity_limit_;
+  double effort_limit_;
+
+  double kp_;
+  double kd_;
+  double max_acceleration_;
+};
+
+/**
+ *  \brief Controller manager for the kinematic simulator, owns a
+ *         KinematicJointHandle for every movable joint in the URDF.
+ */
+class KinematicControllerManager : public ubr_controllers::ControllerManager
+{
+public:
+  KinematicControllerManager(const urdf::Model& model, ros::NodeHandle nh) : nh_(nh)
+  {
+    for (std::map<std::string, boost::shared_ptr<urdf::Joint> >::const_iterator it = model.joints_.begin();
+         it != model.joints_.end(); ++it)
+    {
+      if (it->second->type == urdf::Joint::FIXED ||
+          it->second->type == urdf::Joint::FLOATING ||
+          it->second->type == urdf::Joint::PLANAR)
+        continue;
+
+      boost::shared_ptr<KinematicJointHandle> jh;
+      jh.reset(new KinematicJointHandle(it->second, nh_));
+      this->jointMap_[it->first] = this->handles_.size();
+      this->handles_.push_back(jh);
+    }
+
+    init(nh_);
+  }
+
+  virtual bool init(ros::NodeHandle& nh)
+  {
+    // Load default controllers
+    return ubr_controllers::ControllerManager::init(nh);
+  }
+
+  virtual bool update(const ros::Time now, const ros::Duration dt)
+  {
+    // Clear previous commands
+    for (size_t i = 0; i < this->handles_.size(); ++i)
+      this->handles_[i]->clear();
+
+    // Add controller updates
+    ControllerManager::update(now, dt);
+
+    // Integrate joints
+    double dt_s = dt.toSec();
+    for (size_t i = 0; i < this->handles_.size(); ++i)
+      this->handles_[i]->update(dt_s);
+
+    return true;
+  }
+
+  /**
+   *  \brief Return a handle to the internal joints.
+   */
+  virtual ubr_controllers::JointHandle* getJointHandle(const std::string& name)
+  {
+    std::map<std::string, size_t>::iterator it = this->jointMap_.find(name);
+    if (it != this->jointMap_.end())
+      return this->handles_[it->second].get();
+    else
+    {
+      ROS_ERROR("Did not find joint [%s]", name.c_str());
+      return new ubr_controllers::JointHandle();
+    }
+  }
+
+  /** \brief Get the number of simulated joints. */
+  size_t size() const
+  {
+    return this->handles_.size();
+  }
+
+  /** \brief Get a simulated joint by index. */
+  ubr_controllers::JointHandle* getJoint(size_t index)
+  {
+    return this->handles_[index].get();
+  }
+
+private:
+  ros::NodeHandle nh_;
+  std::vector<boost::shared_ptr<KinematicJointHandle> > handles_;
+  std::map<std::string, size_t> jointMap_;
+};
+
+}  // namespace ubr1_gazebo
+
+#endif  // UBR1_GAZEBO_KINEMATIC_SIMULATOR_H_
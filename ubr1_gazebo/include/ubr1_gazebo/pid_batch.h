@@ -0,0 +1,139 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Author: Michael Ferguson */
+
+#ifndef UBR1_GAZEBO_PID_BATCH_H_
+#define UBR1_GAZEBO_PID_BATCH_H_
+
+#include <algorithm>
+#include <vector>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include <ros/ros.h>
+#include <control_toolbox/pid.h>
+
+namespace ubr1_gazebo
+{
+
+/**
+ *  \brief PID gains and state for many joints, stored as parallel arrays.
+ *         compute() reproduces control_toolbox::Pid::computeCommand(error, dt)
+ *         exactly: the integrated error is never clamped, only the integral
+ *         term of the output is limited to [i_min, i_max].
+ */
+class PidBatch
+{
+public:
+  /** \brief Resize the batch, new entries have zero gains and state. */
+  void resize(size_t n)
+  {
+    p_.resize(n, 0.0);
+    i_.resize(n, 0.0);
+    d_.resize(n, 0.0);
+    i_max_.resize(n, 0.0);
+    i_min_.resize(n, 0.0);
+    i_error_.resize(n, 0.0);
+    d_error_.resize(n, 0.0);
+    p_error_last_.resize(n, 0.0);
+  }
+
+  /** \brief Number of controllers in the batch. */
+  size_t size() const
+  {
+    return p_.size();
+  }
+
+  /** \brief Load gains for controller j the same as control_toolbox::Pid. */
+  bool init(size_t j, const ros::NodeHandle& nh)
+  {
+    control_toolbox::Pid pid;
+    if (!pid.init(nh))
+      return false;
+    pid.getGains(p_[j], i_[j], d_[j], i_max_[j], i_min_[j]);
+    return true;
+  }
+
+  /** \brief Set gains for controller j. */
+  void setGains(size_t j, double p, double i, double d, double i_max, double i_min)
+  {
+    p_[j] = p;
+    i_[j] = i;
+    d_[j] = d;
+    i_max_[j] = i_max;
+    i_min_[j] = i_min;
+  }
+
+  /**
+   *  \brief Compute the command of controller j.
+   *  \param error The error, desired minus measured.
+   *  \param dt Time since the last call, in seconds.
+   */
+  double compute(size_t j, double error, double dt)
+  {
+    if (dt == 0.0 || !boost::math::isfinite(error))
+      return 0.0;
+
+    // Pid keeps the last derivative when time goes backwards
+    double error_dot = d_error_[j];
+    if (dt > 0.0)
+    {
+      error_dot = (error - p_error_last_[j]) / dt;
+      p_error_last_[j] = error;
+    }
+    d_error_[j] = error_dot;
+    if (!boost::math::isfinite(error_dot))
+      return 0.0;
+
+    i_error_[j] += dt * error;
+    double i_term = std::max(i_min_[j], std::min(i_[j] * i_error_[j], i_max_[j]));
+
+    return p_[j] * error + i_term + d_[j] * error_dot;
+  }
+
+private:
+  std::vector<double> p_;
+  std::vector<double> i_;
+  std::vector<double> d_;
+  std::vector<double> i_max_;
+  std::vector<double> i_min_;
+
+  std::vector<double> i_error_;
+  std::vector<double> d_error_;
+  std::vector<double> p_error_last_;
+};
+
+}  // namespace ubr1_gazebo
+
+#endif  // UBR1_GAZEBO_PID_BATCH_H_
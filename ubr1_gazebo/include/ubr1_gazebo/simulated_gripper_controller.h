@@ -39,6 +39,8 @@
 
 #include <string>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <ros/ros.h>
 #include <actionlib/server/simple_action_server.h>
@@ -83,7 +85,10 @@ public:
    */
   virtual bool preempt(bool force);
 
-  /** \brief Update controller, called from controller_manager update */
+  /**
+   *  \brief Update controller, called from controller_manager update. This
+   *         also does goal and stall detection, signaling executeCb.
+   */
   virtual bool update(const ros::Time now, const ros::Duration dt);
 
   /** \brief Get a list of joints this controls. */
@@ -96,13 +101,33 @@ private:
   bool initialized_;
   std::vector<std::string> joint_names_;
 
-  ubr1_gazebo::GazeboJointHandle* left_;
-  ubr1_gazebo::GazeboJointHandle* right_;
+  ubr_controllers::JointHandle* left_;
+  ubr_controllers::JointHandle* right_;
+
+  // Only set when running in Gazebo, used to limit effort
+  ubr1_gazebo::GazeboJointHandle* gazebo_left_;
+  ubr1_gazebo::GazeboJointHandle* gazebo_right_;
 
   // The goal pose for the gripper
   double goal_;
   double fudge_scale_;
 
+  // Goal and stall detection, evaluated on each update
+  double goal_tolerance_;
+  double stall_velocity_;
+  double stall_effort_;
+  ros::Duration stall_window_;
+  bool stalling_;
+  ros::Time stall_start_;
+
+  // State shared between update() and executeCb, protected by mutex_
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool active_goal_;
+  bool done_;
+  bool aborted_;
+  control_msgs::GripperCommandResult result_;
+
   boost::shared_ptr<server_t> server_;
 };
 
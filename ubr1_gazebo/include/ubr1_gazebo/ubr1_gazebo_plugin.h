@@ -46,6 +46,8 @@
 
 #include <sensor_msgs/JointState.h>
 
+#include <boost/thread/mutex.hpp>
+
 namespace gazebo
 {
 
@@ -59,22 +61,48 @@ public:
 
 private:
 
-  /** \brief Callback to handle periodic updating for Gazebo */
+  /** \brief Update the controllers of this robot, publish joint states */
   void OnUpdate();
 
-  event::ConnectionPtr updateConnection;
+  /**
+   *  \brief Single world update callback, shared by all robots in the world,
+   *         which steps each robot in turn.
+   */
+  static void OnWorldUpdate();
+
+  /// All robots in this gzserver, and the connection used to update them
+  static std::vector<UBR1GazeboPlugin*> robots_;
+  static event::ConnectionPtr updateConnection;
+  static boost::mutex robots_mutex_;
+
+  /// If non-zero, log the mean wall time of the world update every this many steps
+  static int benchmark_steps_;
+  static int benchmark_count_;
+  static double benchmark_time_;
+
+  /// Namespace of this robot, empty if the only robot
+  std::string robot_namespace_;
 
   physics::ModelPtr model;
   std::vector<std::string> jointNames;
 
   common::Time prevUpdateTime;
 
+  // If true, step controllers by the physics step size rather than sim time delta
+  bool fixed_step_;
+
   ubr1_gazebo::GazeboControllerManager* manager_;
 
   ros::Publisher joint_state_pub_;
   ros::NodeHandle nh_;
+  ros::NodeHandle config_nh_;
+
+  // Prebuilt joint_states message, names filled in at Init()
+  sensor_msgs::JointStatePtr joint_state_;
+  std::vector<ubr_controllers::JointHandle*> joint_handles_;
 
   ros::Time last_publish_;
+  ros::Duration publish_period_;
 };
 
 }  // namespace gazebo
@@ -0,0 +1,173 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Author: Michael Ferguson
+
+#include <ros/ros.h>
+#include <rosgraph_msgs/Clock.h>
+#include <sensor_msgs/JointState.h>
+#include <urdf/model.h>
+
+#include <ubr1_gazebo/kinematic_simulator.h>
+
+/*
+ * Gazebo-free simulator for testing controllers. This steps the controller
+ * manager at a fixed rate, publishing /clock, so that everything downstream
+ * runs on simulated time. If real_time_factor is 0, it runs as fast as it can.
+ */
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "kinematic_simulator");
+  ros::NodeHandle nh;
+  ros::NodeHandle pnh("~");
+
+  // Controllers and joint parameters live in the same place as for Gazebo
+  std::string config_ns;
+  pnh.param<std::string>("config_namespace", config_ns, "gazebo");
+  ros::NodeHandle config_nh(config_ns);
+
+  double update_rate, real_time_factor, publish_rate;
+  pnh.param("update_rate", update_rate, 1000.0);
+  pnh.param("real_time_factor", real_time_factor, 1.0);
+  config_nh.param("publish_rate", publish_rate, 100.0);
+  if (update_rate <= 0.0 || real_time_factor < 0.0 || publish_rate <= 0.0)
+  {
+    ROS_FATAL("update_rate and publish_rate must be positive, real_time_factor must not be negative");
+    return -1;
+  }
+
+  urdf::Model model;
+  if (!model.initParam("robot_description"))
+  {
+    ROS_FATAL("Failed to parse URDF, is robot_description parameter set?");
+    return -1;
+  }
+
+  ros::Publisher clock_pub = nh.advertise<rosgraph_msgs::Clock>("/clock", 1);
+  ros::Publisher joint_state_pub = nh.advertise<sensor_msgs::JointState>("joint_states", 10);
+
+  // Controllers may call ros::Time::now() during init, start the clock first
+  ros::Time now(1.0);
+  rosgraph_msgs::ClockPtr clock(new rosgraph_msgs::Clock());
+  clock->clock = now;
+  clock_pub.publish(clock);
+
+  // Action servers and subscribers in controllers need spinning
+  ros::AsyncSpinner spinner(2);
+  spinner.start();
+
+  ubr1_gazebo::KinematicControllerManager manager(model, config_nh);
+
+  // Start the same controllers the Gazebo plugin does
+  std::vector<std::string> autostart;
+  XmlRpc::XmlRpcValue names;
+  if (pnh.getParam("autostart", names) && names.getType() == XmlRpc::XmlRpcValue::TypeArray)
+  {
+    for (int i = 0; i < names.size(); ++i)
+    {
+      if (names[i].getType() == XmlRpc::XmlRpcValue::TypeString)
+        autostart.push_back(static_cast<std::string>(names[i]));
+    }
+  }
+  else
+  {
+    autostart.push_back("arm_controller/gravity_compensation");
+    autostart.push_back("gripper_controller/gripper_action");
+    autostart.push_back("bellows_controller");
+  }
+  for (size_t i = 0; i < autostart.size(); ++i)
+    manager.requestStart(autostart[i]);
+
+  // Prebuilt joint_states message
+  sensor_msgs::JointStatePtr js(new sensor_msgs::JointState());
+  for (size_t i = 0; i < manager.size(); ++i)
+    js->name.push_back(manager.getJoint(i)->getName());
+  js->position.resize(manager.size());
+  js->velocity.resize(manager.size());
+  js->effort.resize(manager.size());
+
+  ros::Duration dt(1.0 / update_rate);
+  ros::Duration publish_period(1.0 / publish_rate);
+  ros::Time last_publish = now;
+  ros::WallTime wall_start = ros::WallTime::now();
+  ros::Time sim_start = now;
+  unsigned long ticks = 0;
+
+  ROS_INFO("Finished initializing kinematic simulator with %zu joints", manager.size());
+
+  while (ros::ok())
+  {
+    now += dt;
+    manager.update(now, dt);
+    ++ticks;
+
+    if (now - last_publish >= publish_period)
+    {
+      clock.reset(new rosgraph_msgs::Clock());
+      clock->clock = now;
+      clock_pub.publish(clock);
+
+      if (!js.unique())
+        js.reset(new sensor_msgs::JointState(*js));
+      js->header.stamp = now;
+      for (size_t i = 0; i < manager.size(); ++i)
+      {
+        ubr_controllers::JointHandle* j = manager.getJoint(i);
+        js->position[i] = j->getPosition();
+        js->velocity[i] = j->getVelocity();
+        js->effort[i] = j->getEffort();
+      }
+      joint_state_pub.publish(js);
+
+      last_publish = now;
+    }
+
+    // Throttle to the requested real time factor
+    if (real_time_factor > 0.0)
+    {
+      ros::WallTime target = wall_start + ros::WallDuration((now - sim_start).toSec() / real_time_factor);
+      ros::WallTime wall_now = ros::WallTime::now();
+      if (target > wall_now)
+        (target - wall_now).sleep();
+    }
+
+    if (ticks % 10000 == 0)
+    {
+      double wall = (ros::WallTime::now() - wall_start).toSec();
+      ROS_DEBUG("Kinematic simulator running at %.0f ticks/sec", ticks / wall);
+    }
+  }
+
+  return 0;
+}
@@ -57,9 +57,11 @@ bool SimulatedGripperController::init(ros::NodeHandle& nh, ubr_controllers::Cont
   joint_names_.push_back("left_gripper_joint");
   joint_names_.push_back("right_gripper_joint");
 
-  // Get Joint Handles
-  left_ = dynamic_cast<ubr1_gazebo::GazeboJointHandle*>(manager_->getJointHandle("left_gripper_joint"));
-  right_ = dynamic_cast<ubr1_gazebo::GazeboJointHandle*>(manager_->getJointHandle("right_gripper_joint"));
+  // Get Joint Handles, effort limits are only available when running in Gazebo
+  left_ = manager_->getJointHandle("left_gripper_joint");
+  right_ = manager_->getJointHandle("right_gripper_joint");
+  gazebo_left_ = dynamic_cast<ubr1_gazebo::GazeboJointHandle*>(left_);
+  gazebo_right_ = dynamic_cast<ubr1_gazebo::GazeboJointHandle*>(right_);
 
   // Setup ROS interfaces
   server_.reset(new server_t(nh, "", /*"gripper_controller/gripper_action",*/
@@ -71,6 +73,16 @@ bool SimulatedGripperController::init(ros::NodeHandle& nh, ubr_controllers::Cont
   goal_ = 0.09;
   fudge_scale_ = 2.0;
 
+  // Stall is low velocity, with effort applied, for some amount of time
+  double stall_window;
+  nh.param("goal_tolerance", goal_tolerance_, 0.002);
+  nh.param("stall_velocity", stall_velocity_, 0.005);
+  nh.param("stall_effort", stall_effort_, 1.0);
+  nh.param("stall_window", stall_window, 0.25);
+  stall_window_ = ros::Duration(stall_window);
+
+  active_goal_ = done_ = aborted_ = stalling_ = false;
+
   initialized_ = true;
 
   return true;
@@ -97,9 +109,14 @@ bool SimulatedGripperController::preempt(bool force)
   {
     if (force)
     {
-      // Shut down the action
-      control_msgs::GripperCommandResult result;
-      server_->setAborted(result, "Controller manager forced preemption.");
+      // Shut down the action, executeCb will abort the goal
+      boost::mutex::scoped_lock lock(mutex_);
+      if (active_goal_)
+      {
+        active_goal_ = false;
+        done_ = aborted_ = true;
+        cond_.notify_all();
+      }
       return true;
     }
     // Do not abort unless forced
@@ -115,9 +132,55 @@ bool SimulatedGripperController::update(const ros::Time now, const ros::Duration
   if (!initialized_)
     return false;
 
+  boost::mutex::scoped_lock lock(mutex_);
+
   left_->setPositionCommand(goal_/2.0, 0, 0);
   right_->setPositionCommand(goal_/2.0, 0, 0);
 
+  if (!active_goal_)
+    return true;
+
+  double position = left_->getPosition() + right_->getPosition();
+  double velocity = left_->getVelocity() + right_->getVelocity();
+  double effort = left_->getEffort() + right_->getEffort();
+
+  // Goal detection
+  if (fabs(position - goal_) < goal_tolerance_)
+  {
+    result_.position = position;
+    result_.effort = effort;
+    result_.reached_goal = true;
+    result_.stalled = false;
+    active_goal_ = false;
+    done_ = true;
+    cond_.notify_all();
+    return true;
+  }
+
+  // Stall detection
+  if (fabs(velocity) < stall_velocity_ && fabs(effort) >= stall_effort_)
+  {
+    if (!stalling_)
+    {
+      stalling_ = true;
+      stall_start_ = now;
+    }
+    else if (now - stall_start_ >= stall_window_)
+    {
+      result_.position = position;
+      result_.effort = effort;
+      result_.reached_goal = false;
+      result_.stalled = true;
+      active_goal_ = false;
+      done_ = true;
+      cond_.notify_all();
+    }
+  }
+  else
+  {
+    stalling_ = false;
+  }
+
   return true;
 }
 
@@ -140,73 +203,61 @@ void SimulatedGripperController::executeCb(const control_msgs::GripperCommandGoa
   }
 
   // If effort == 0.0, assume that user did not fill it in, and use max effort
-  if (goal->command.max_effort <= 0.0 || goal->command.max_effort > 28.0)
+  double max_effort = goal->command.max_effort;
+  if (max_effort <= 0.0 || max_effort > 28.0)
+    max_effort = 28.0;
+  if (gazebo_left_ && gazebo_right_)
   {
-    left_->setMaxEffort(fudge_scale_ * 28.0);
-    right_->setMaxEffort(fudge_scale_ * 28.0);
+    gazebo_left_->setMaxEffort(fudge_scale_ * max_effort);
+    gazebo_right_->setMaxEffort(fudge_scale_ * max_effort);
   }
-  else
+
+  // Set goal position, update() will signal when done
   {
-    left_->setMaxEffort(fudge_scale_ * goal->command.max_effort);
-    right_->setMaxEffort(fudge_scale_ * goal->command.max_effort);
+    boost::mutex::scoped_lock lock(mutex_);
+    goal_ = goal->command.position;
+    stalling_ = false;
+    done_ = aborted_ = false;
+    active_goal_ = true;
   }
 
-  // Set goal position
-  float last_position = left_->getPosition() + right_->getPosition();
-  ros::Time last_position_time = ros::Time::now();
-  goal_ = goal->command.position;
-
-  ros::Rate r(50);
   while (true)
   {
     // Abort detection
     if (server_->isPreemptRequested() || !ros::ok())
     {
+      boost::mutex::scoped_lock lock(mutex_);
+      active_goal_ = false;
       ROS_DEBUG_NAMED("DefaultGripperPlugin", "Command preempted.");
       server_->setPreempted();
-      break;
+      return;
     }
 
-    // Publish feedback before possibly completing
+    // Publish feedback
     feedback.position = left_->getPosition() + right_->getPosition();
     feedback.effort = left_->getEffort() + right_->getEffort();
     feedback.reached_goal = false;
     feedback.stalled = false;
     server_->publishFeedback(feedback);
 
-    // Goal detection
-    if (fabs(feedback.position - goal->command.position) < 0.002)
-    {
-      result.position = feedback.position;
-      result.effort = feedback.effort;
-      result.reached_goal = true;
-      result.stalled = false;
-      ROS_DEBUG_NAMED("DefaultGripperPlugin", "Command Succeeded.");
-      server_->setSucceeded(result);
-      return;
-    }
-
-    // Stall detection
-    if (fabs(feedback.position - last_position) > 0.005)
-    {
-      last_position = feedback.position;
-      last_position_time = ros::Time::now();
-    }
-    else
+    // Wait for update() to finish the goal, waking to check preemption
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!done_)
+      cond_.timed_wait(lock, boost::posix_time::milliseconds(20));
+    if (done_)
     {
-      if (ros::Time::now() - last_position_time > ros::Duration(2.0))
+      if (aborted_)
       {
-        result.position = feedback.position;
-        result.effort = feedback.effort;
-        result.reached_goal = false;
-        result.stalled = true;
-        ROS_DEBUG_NAMED("DefaultGripperPlugin", "Gripper stalled, but succeeding.");
-        server_->setSucceeded(result);
+        server_->setAborted(result, "Controller manager forced preemption.");
         return;
       }
+      if (result_.stalled)
+        ROS_DEBUG_NAMED("DefaultGripperPlugin", "Gripper stalled, but succeeding.");
+      else
+        ROS_DEBUG_NAMED("DefaultGripperPlugin", "Command Succeeded.");
+      server_->setSucceeded(result_);
+      return;
     }
-
-    r.sleep();
   }
 }
 
@@ -34,46 +34,147 @@
 
 // Authors: John Hsu, Michael Ferguson
 
+#include <algorithm>
 #include <ubr1_gazebo/ubr1_gazebo_plugin.h>
-#include <ubr_controllers/base_controller.h>
 
 using namespace gazebo;
 GZ_REGISTER_MODEL_PLUGIN(UBR1GazeboPlugin)
 
-UBR1GazeboPlugin::UBR1GazeboPlugin() : nh_()
+std::vector<UBR1GazeboPlugin*> UBR1GazeboPlugin::robots_;
+event::ConnectionPtr UBR1GazeboPlugin::updateConnection;
+boost::mutex UBR1GazeboPlugin::robots_mutex_;
+int UBR1GazeboPlugin::benchmark_steps_ = 0;
+int UBR1GazeboPlugin::benchmark_count_ = 0;
+double UBR1GazeboPlugin::benchmark_time_ = 0.0;
+
+UBR1GazeboPlugin::UBR1GazeboPlugin() : fixed_step_(false), manager_(NULL)
 {
 }
 
 UBR1GazeboPlugin::~UBR1GazeboPlugin()
 {
+  event::ConnectionPtr connection;
+  {
+    boost::mutex::scoped_lock lock(robots_mutex_);
+    robots_.erase(std::remove(robots_.begin(), robots_.end(), this), robots_.end());
+    if (robots_.empty())
+      connection.swap(updateConnection);
+  }
+
+  // Older Gazebo does not disconnect when the connection is destroyed.
+  //  Done outside the lock, as the update callback takes it.
+  if (connection)
+    event::Events::DisconnectWorldUpdateBegin(connection);
+
   delete this->manager_;
 }
 
-void UBR1GazeboPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr /*_sdf*/)
+void UBR1GazeboPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
 {
   this->model = _model;
   last_publish_ = ros::Time(this->model->GetWorld()->GetSimTime().Double());
 
-  this->updateConnection = event::Events::ConnectWorldUpdateBegin(
-          boost::bind(&UBR1GazeboPlugin::OnUpdate, this));
+  // Each robot can be in its own namespace (set by spawn_model -robot_namespace)
+  if (_sdf->HasElement("robotNamespace"))
+    this->robot_namespace_ = _sdf->GetElement("robotNamespace")->Get<std::string>();
+  this->nh_ = ros::NodeHandle(this->robot_namespace_);
+  if (this->robot_namespace_.empty())
+    this->config_nh_ = ros::NodeHandle("~");
+  else
+    this->config_nh_ = ros::NodeHandle(this->nh_, "gazebo");
+
+  // All robots are stepped from a single world update callback
+  boost::mutex::scoped_lock lock(robots_mutex_);
+  robots_.push_back(this);
+  if (!updateConnection)
+  {
+    // Benchmarking is a property of the gzserver, not of any one robot
+    ros::NodeHandle("~").param("benchmark_steps", benchmark_steps_, 0);
+    updateConnection = event::Events::ConnectWorldUpdateBegin(
+          boost::bind(&UBR1GazeboPlugin::OnWorldUpdate));
+  }
 }
 
 void UBR1GazeboPlugin::Init()
 {
   // Loads controllers
-  this->manager_ = new ubr1_gazebo::GazeboControllerManager(this->model);
+  ubr1_gazebo::GazeboControllerManager* manager =
+    new ubr1_gazebo::GazeboControllerManager(this->model, this->nh_, this->config_nh_);
+
+  // Controller names include the robot namespace
+  std::string prefix = this->robot_namespace_.empty() ? "" : this->robot_namespace_ + "/";
+  if (!prefix.empty() && prefix[0] == '/')
+    prefix.erase(0, 1);
 
   // Start gravity compensation
-  this->manager_->requestStart("arm_controller/gravity_compensation");
+  manager->requestStart(prefix + "arm_controller/gravity_compensation");
 
   // Start the simulated controllers
-  this->manager_->requestStart("gripper_controller/gripper_action");
-  this->manager_->requestStart("bellows_controller");
+  manager->requestStart(prefix + "gripper_controller/gripper_action");
+  manager->requestStart(prefix + "bellows_controller");
+
+  // Build joint_states message once, caching handles by index
+  this->joint_state_.reset(new sensor_msgs::JointState());
+  gazebo::physics::Joint_V joints = this->model->GetJoints();
+  for (gazebo::physics::Joint_V::iterator it = joints.begin(); it != joints.end(); ++it)
+  {
+    this->joint_handles_.push_back(manager->getJointHandle((*it)->GetName()));
+    this->joint_state_->name.push_back((*it)->GetName());
+  }
+  this->joint_state_->position.resize(this->joint_handles_.size());
+  this->joint_state_->velocity.resize(this->joint_handles_.size());
+  this->joint_state_->effort.resize(this->joint_handles_.size());
+
+  double publish_rate;
+  this->config_nh_.param("publish_rate", publish_rate, 100.0);
+  if (publish_rate <= 0.0)
+  {
+    ROS_ERROR("publish_rate must be positive, using 100.0");
+    publish_rate = 100.0;
+  }
+  this->publish_period_ = ros::Duration(1.0 / publish_rate);
+  this->config_nh_.param("fixed_step", this->fixed_step_, false);
 
   // Publish joint states only after controllers are fully ready
   this->joint_state_pub_ = nh_.advertise<sensor_msgs::JointState>("joint_states", 10);
 
-  ROS_INFO("Finished initializing UBR1GazeboPlugin");
+  // Only now is this robot ready to be updated
+  {
+    boost::mutex::scoped_lock lock(robots_mutex_);
+    this->manager_ = manager;
+  }
+
+  ROS_INFO("Finished initializing UBR1GazeboPlugin %s", this->robot_namespace_.c_str());
+}
+
+void UBR1GazeboPlugin::OnWorldUpdate()
+{
+  boost::mutex::scoped_lock lock(robots_mutex_);
+  ros::WallTime start;
+  if (benchmark_steps_ > 0)
+    start = ros::WallTime::now();
+
+  for (size_t i = 0; i < robots_.size(); ++i)
+  {
+    if (robots_[i]->manager_)
+      robots_[i]->OnUpdate();
+  }
+
+  if (benchmark_steps_ > 0)
+  {
+    benchmark_time_ += (ros::WallTime::now() - start).toSec();
+    if (++benchmark_count_ >= benchmark_steps_)
+    {
+      size_t joints = 0;
+      for (size_t i = 0; i < robots_.size(); ++i)
+        joints += robots_[i]->joint_handles_.size();
+      double us = 1e6 * benchmark_time_ / benchmark_count_;
+      ROS_INFO("Controller update for %zu robots, %zu joints: %.2f us/step, %.3f us/joint",
+               robots_.size(), joints, us, joints > 0 ? us / joints : 0.0);
+      benchmark_count_ = 0;
+      benchmark_time_ = 0.0;
+    }
+  }
 }
 
 void UBR1GazeboPlugin::OnUpdate()
@@ -86,36 +187,35 @@ void UBR1GazeboPlugin::OnUpdate()
   common::Time stepTime = currTime - this->prevUpdateTime;
   this->prevUpdateTime = currTime;
   double dt = stepTime.Double();
+  if (this->fixed_step_)
+  {
+    // Deterministic, one controller update per physics step
+    dt = this->model->GetWorld()->GetPhysicsEngine()->GetMaxStepSize();
+  }
   ros::Time now = ros::Time(currTime.Double());
 
   // Update controllers
   this->manager_->update(now, ros::Duration(dt));
 
   // Limit publish rate
-  if (now - last_publish_ < ros::Duration(0.01))
+  if (now - last_publish_ < publish_period_)
     return;
 
-  // Publish joint_state message
-  sensor_msgs::JointState js;
-  js.header.stamp = ros::Time(currTime.Double());
-  gazebo::physics::Joint_V joints = this->model->GetJoints();
-  for (gazebo::physics::Joint_V::iterator it = joints.begin(); it != joints.end(); ++it)
+  /*
+   * Publish joint_state message. Subscribers in the same process hold on to
+   * the message we publish, only reuse it if nobody else has a reference.
+   */
+  if (!this->joint_state_.unique())
+    this->joint_state_.reset(new sensor_msgs::JointState(*this->joint_state_));
+  sensor_msgs::JointState& js = *this->joint_state_;
+  js.header.stamp = now;
+  for (size_t i = 0; i < this->joint_handles_.size(); ++i)
   {
-    ubr_controllers::JointHandle* j = this->manager_->getJointHandle((*it)->GetName());
-    js.name.push_back((*it)->GetName());
-    js.position.push_back(j->getPosition());
-    js.velocity.push_back(j->getVelocity());
-    js.effort.push_back(j->getEffort());
-  }
-  joint_state_pub_.publish(js);
-
-  // Publish Base Odometry
-  ubr_controllers::Controller * base = this->manager_->getController("base_controller");
-  if (base)
-  {
-    dynamic_cast<ubr_controllers::BaseController*>(base)->publish(ros::Time::now());
+    js.position[i] = this->joint_handles_[i]->getPosition();
+    js.velocity[i] = this->joint_handles_[i]->getVelocity();
+    js.effort[i] = this->joint_handles_[i]->getEffort();
   }
+  joint_state_pub_.publish(this->joint_state_);
 
   last_publish_ = now;
 }
-
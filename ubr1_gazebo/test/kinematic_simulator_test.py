@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+
+import time
+import unittest
+
+import rospy
+import rostest
+from geometry_msgs.msg import Twist
+from nav_msgs.msg import Odometry
+from sensor_msgs.msg import JointState
+
+class KinematicSimulatorTest(unittest.TestCase):
+
+    def setUp(self):
+        self.joint_states = list()
+        self.odom = list()
+        rospy.Subscriber("joint_states", JointState, self.joint_states.append)
+        rospy.Subscriber("odom", Odometry, self.odom.append)
+        self.cmd_pub = rospy.Publisher("base_controller/command", Twist, queue_size=1)
+
+    def wait_for(self, messages, timeout):
+        # Wall time, so the wait still ends if the simulated clock never starts
+        start = time.time()
+        while not messages and not rospy.is_shutdown():
+            if time.time() - start > timeout:
+                break
+            time.sleep(0.1)
+        return len(messages) > 0
+
+    # Named to sort before the driving test, so no command has been sent yet
+    def test_idle_odom(self):
+        # base_controller is not active until the first command, but odom
+        #  and its stamps must still advance, for localization at startup
+        self.assertTrue(self.wait_for(self.odom, 20.0), "no odom received")
+        odom_start = self.odom[-1]
+        rospy.sleep(1.0)
+        odom_end = self.odom[-1]
+        self.assertGreater(odom_end.header.stamp, odom_start.header.stamp)
+        self.assertEqual(odom_end.header.frame_id, "odom")
+        self.assertEqual(odom_end.child_frame_id, "base_link")
+        self.assertAlmostEqual(odom_end.pose.pose.position.x, 0.0)
+        self.assertAlmostEqual(odom_end.twist.twist.linear.x, 0.0)
+
+    def test_joint_states_and_odom_advance(self):
+        self.assertTrue(self.wait_for(self.joint_states, 20.0), "no joint_states received")
+        self.assertTrue(self.wait_for(self.odom, 20.0), "no odom received")
+        js_start = self.joint_states[-1]
+        odom_start = self.odom[-1]
+
+        # Drive forward for two seconds of sim time
+        cmd = Twist()
+        cmd.linear.x = 0.25
+        end = rospy.Time.now() + rospy.Duration(2.0)
+        while rospy.Time.now() < end and not rospy.is_shutdown():
+            self.cmd_pub.publish(cmd)
+            rospy.sleep(0.05)
+        self.cmd_pub.publish(Twist())
+        rospy.sleep(0.5)
+
+        js_end = self.joint_states[-1]
+        odom_end = self.odom[-1]
+
+        # Both topics are stamped with sim time, which must advance
+        self.assertGreater(js_end.header.stamp, js_start.header.stamp)
+        self.assertGreater(odom_end.header.stamp, odom_start.header.stamp)
+
+        # The wheels turned, and the base moved forward
+        wheel = js_start.name.index("base_l_wheel_joint")
+        self.assertNotAlmostEqual(js_start.position[wheel], js_end.position[wheel], places=2)
+        self.assertGreater(odom_end.pose.pose.position.x - odom_start.pose.pose.position.x, 0.1)
+
+if __name__ == "__main__":
+    rospy.init_node("kinematic_simulator_test")
+    rostest.rosrun("ubr1_gazebo", "kinematic_simulator_test", KinematicSimulatorTest)
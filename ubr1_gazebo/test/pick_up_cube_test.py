@@ -1,5 +1,7 @@
 #!/usr/bin/env python
 
+import time
+
 import rospy
 import rosbag
 import actionlib
@@ -20,7 +22,7 @@ class PickUpCubeTest:
         rospy.loginfo("...connected")
 
     def run(self):
-        bag = rosbag.Bag("pick_up_cube_trajectories.bag")
+        bag = rosbag.Bag(rospy.get_param("~bag", "pick_up_cube_trajectories.bag"))
         msg_count = 0
         for topic, msg, t in bag.read_messages():
             # send each trajectory
@@ -39,5 +41,13 @@ class PickUpCubeTest:
 if __name__ == "__main__":
     rospy.init_node("pick_up_cube_test")
     test = PickUpCubeTest()
+
+    # Report wall and sim time, so we can track cost of the test
+    wall_start = time.time()
+    sim_start = rospy.Time.now()
     test.run()
+    wall = time.time() - wall_start
+    sim = (rospy.Time.now() - sim_start).to_sec()
+    rospy.loginfo("pick_up_cube_test took %.2fs wall time, %.2fs sim time (%.1fx real time)",
+                  wall, sim, sim / wall if wall > 0 else 0.0)
 
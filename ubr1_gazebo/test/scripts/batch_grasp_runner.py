@@ -0,0 +1,193 @@
+#!/usr/bin/env python
+
+# Copyright 2014, Unbounded Robotics, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above
+#    copyright notice, this list of conditions and the following
+#    disclaimer in the documentation and/or other materials provided
+#    with the distribution.
+#  * Neither the name of Unbounded Robotics, Inc. nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# Author: Michael Ferguson
+
+"""
+Run a sweep of grasp scenarios across several isolated, headless
+gzserver instances. Each worker gets its own ROS master and Gazebo
+master port, so instances never see each other's topics. Each worker
+takes two consecutive ports, so ROS and Gazebo ports never collide no
+matter how many workers are used.
+
+Scenarios are given as a YAML list, each entry may set cube_x, cube_y
+and/or world, for instance:
+
+  - {cube_x: 0.25, cube_y: -0.25}
+  - {cube_x: 0.30, cube_y: -0.20, world: /path/to/world.sdf}
+
+or generated as a grid with --grid "x_min:x_max:n,y_min:y_max:n".
+"""
+
+import argparse
+import json
+import os
+import Queue
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import yaml
+
+BASE_PORT = 11411
+
+def get_ports(worker):
+    """ Returns (ros_port, gazebo_port) for a worker. """
+    return BASE_PORT + 2 * worker, BASE_PORT + 2 * worker + 1
+
+def make_grid(spec):
+    axes = list()
+    for axis in spec.split(","):
+        lo, hi, n = axis.split(":")
+        lo, hi, n = float(lo), float(hi), int(n)
+        if n == 1:
+            axes.append([lo])
+        else:
+            axes.append([lo + (hi - lo) * i / (n - 1) for i in range(n)])
+    return [{"cube_x": x, "cube_y": y} for x in axes[0] for y in axes[1]]
+
+def run_scenario(worker, index, scenario, timeout, log_dir):
+    ros_port, gazebo_port = get_ports(worker)
+    env = dict(os.environ)
+    env["ROS_MASTER_URI"] = "http://localhost:%d" % ros_port
+    env["GAZEBO_MASTER_URI"] = "http://localhost:%d" % gazebo_port
+
+    result_file = os.path.join(log_dir, "result_%04d.json" % index)
+    cmd = ["roslaunch", "-p", str(ros_port),
+           "ubr1_gazebo", "grasp_test_headless.launch",
+           "result_file:=%s" % result_file]
+    for key in ["cube_x", "cube_y", "world"]:
+        if key in scenario:
+            cmd.append("%s:=%s" % (key, scenario[key]))
+
+    start = time.time()
+    with open(os.path.join(log_dir, "log_%04d.txt" % index), "w") as log:
+        # New process group, so that we can kill everything on timeout
+        proc = subprocess.Popen(cmd, env=env, stdout=log, stderr=subprocess.STDOUT,
+                                preexec_fn=os.setsid)
+        timed_out = False
+        while proc.poll() is None:
+            if time.time() - start > timeout:
+                timed_out = True
+                os.killpg(proc.pid, signal.SIGINT)
+                time.sleep(5.0)
+                if proc.poll() is None:
+                    os.killpg(proc.pid, signal.SIGKILL)
+                proc.wait()
+                break
+            time.sleep(0.5)
+
+    result = {"index": index, "worker": worker, "scenario": scenario,
+              "passed": False, "timed_out": timed_out,
+              "launch_time": time.time() - start}
+    try:
+        with open(result_file) as f:
+            result.update(json.load(f))
+    except (IOError, ValueError):
+        result["error"] = "no result"
+    return result
+
+def worker_loop(worker, queue, results, lock, timeout, log_dir):
+    while True:
+        try:
+            index, scenario = queue.get_nowait()
+        except Queue.Empty:
+            return
+        result = run_scenario(worker, index, scenario, timeout, log_dir)
+        with lock:
+            results.append(result)
+            print("[%d/%d] worker %d: %s %s (%.1fs)" % (len(results), results.total, worker,
+                  "PASS" if result["passed"] else "FAIL", scenario, result["launch_time"]))
+            sys.stdout.flush()
+
+class Results(list):
+    total = 0
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Run grasp scenarios across parallel gzserver instances.")
+    parser.add_argument("scenarios", nargs="?", help="YAML file with list of scenarios")
+    parser.add_argument("--grid", help="Generate scenarios as x_min:x_max:n,y_min:y_max:n")
+    parser.add_argument("-j", "--jobs", type=int, default=2, help="Number of parallel gzserver instances")
+    parser.add_argument("--timeout", type=float, default=300.0, help="Wall time limit per scenario")
+    parser.add_argument("--log-dir", help="Where to store logs and per-scenario results")
+    parser.add_argument("--report", default="grasp_report.json", help="Summary report file")
+    args = parser.parse_args()
+
+    if args.grid:
+        scenarios = make_grid(args.grid)
+    elif args.scenarios:
+        with open(args.scenarios) as f:
+            scenarios = yaml.safe_load(f)
+    else:
+        parser.error("Need either a scenarios file or --grid")
+
+    log_dir = args.log_dir or tempfile.mkdtemp(prefix="grasp_sweep_")
+    if not os.path.exists(log_dir):
+        os.makedirs(log_dir)
+
+    queue = Queue.Queue()
+    for i, s in enumerate(scenarios):
+        queue.put((i, s))
+    results = Results()
+    results.total = len(scenarios)
+    lock = threading.Lock()
+
+    print("Running %d scenarios on %d workers, logs in %s" % (len(scenarios), args.jobs, log_dir))
+    start = time.time()
+    threads = [threading.Thread(target=worker_loop, args=(w, queue, results, lock, args.timeout, log_dir))
+               for w in range(args.jobs)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    wall = time.time() - start
+
+    results.sort(key=lambda r: r["index"])
+    passed = [r for r in results if r["passed"]]
+    times = sorted([r["launch_time"] for r in results])
+    summary = {"scenarios": len(results),
+               "passed": len(passed),
+               "failed": len(results) - len(passed),
+               "timed_out": len([r for r in results if r["timed_out"]]),
+               "jobs": args.jobs,
+               "wall_time": wall,
+               "median_scenario_time": times[len(times) / 2] if times else 0.0,
+               "results": list(results)}
+    with open(args.report, "w") as f:
+        json.dump(summary, f, indent=2)
+
+    print("%d/%d passed (%d timed out) in %.1fs wall time, report in %s" %
+          (summary["passed"], summary["scenarios"], summary["timed_out"], wall, args.report))
+    sys.exit(0 if summary["failed"] == 0 else 1)
@@ -1,23 +1,59 @@
 #!/usr/bin/env python
 
 import copy
+import json
 import math
 import sys
+import time
 
 import rospy
 import actionlib
 from moveit_python import *
 from moveit_python.geometry import *
 
+from gazebo_msgs.msg import ModelState
+from gazebo_msgs.srv import GetModelState, SetModelState
 from geometry_msgs.msg import *
 from grasping_msgs.msg import *
 from moveit_msgs.msg import *
 from trajectory_msgs.msg import *
 
-def create_cube(interface):
-    interface.addCube("cube", 0.06, 0.25, -0.25, 0.03)
+def create_cube(interface, x, y):
+    interface.addCube("cube", 0.06, x, y, 0.03)
     return interface._objects["cube"]
 
+# Move the cube in gazebo, returns False if gazebo is not available
+def move_cube(x, y, timeout=10.0):
+    try:
+        rospy.wait_for_service("/gazebo/set_model_state", timeout)
+    except rospy.ROSException:
+        return False
+    state = ModelState()
+    state.model_name = "ubr_cube"
+    state.reference_frame = "world"
+    state.pose.position.x = x
+    state.pose.position.y = y
+    state.pose.position.z = 0.03
+    state.pose.orientation.w = 1.0
+    set_state = rospy.ServiceProxy("/gazebo/set_model_state", SetModelState)
+    try:
+        return set_state(state).success
+    except rospy.ServiceException:
+        return False
+
+# Get the height of the cube in gazebo, or None if not available
+def get_cube_height():
+    try:
+        get_state = rospy.ServiceProxy("/gazebo/get_model_state", GetModelState)
+        return get_state("ubr_cube", "world").pose.position.z
+    except rospy.ServiceException:
+        return None
+
+def write_result(result_file, result):
+    if result_file:
+        with open(result_file, "w") as f:
+            json.dump(result, f)
+
 def make_gripper_posture(pose):
     t = JointTrajectory()
     t.joint_names = ["left_gripper_joint", "left_gripper_joint"]
@@ -58,10 +94,26 @@ def make_grasps(pose_stamped):
 if __name__=="__main__":
     rospy.init_node("generate_grasp_test")
 
+    # Optional cube location, used by batch_grasp_runner.py for sweeps
+    x = rospy.get_param("~cube_x", 0.25)
+    y = rospy.get_param("~cube_y", -0.25)
+    result_file = rospy.get_param("~result_file", "")
+    if not move_cube(x, y):
+        # Cube is not where the scene says it is, the result would be meaningless
+        rospy.logerr("Unable to move cube to %.3f, %.3f", x, y)
+        write_result(result_file, {"cube_x": x,
+                                   "cube_y": y,
+                                   "passed": False,
+                                   "error": "unable to move cube"})
+        sys.exit(1)
+
+    wall_start = time.time()
+    sim_start = rospy.Time.now()
+
     scene = PlanningSceneInterface("base_link")
     pickplace = PickPlaceInterface("arm", "gripper", verbose = True)
 
-    cube = create_cube(scene)
+    cube = create_cube(scene, x, y)
     pose_stamped = PoseStamped()
     pose_stamped.pose = cube.primitive_poses[0]
     pose_stamped.header.frame_id = "base_link"
@@ -70,3 +122,16 @@ if __name__=="__main__":
     rospy.loginfo("Beginning to pick.")
     success, pick_result = pickplace.pick_with_retry("cube", grasps, scene = scene)
 
+    # Cube must have actually left the ground for this to be a pass
+    height = get_cube_height()
+    lifted = height is not None and height > 0.03 + 0.05
+    result = {"cube_x": x,
+              "cube_y": y,
+              "pick_success": bool(success),
+              "cube_height": height,
+              "passed": bool(success) and lifted,
+              "wall_time": time.time() - wall_start,
+              "sim_time": (rospy.Time.now() - sim_start).to_sec()}
+    rospy.loginfo("Grasp test %s in %.2fs wall time",
+                  "passed" if result["passed"] else "failed", result["wall_time"])
+    write_result(result_file, result)
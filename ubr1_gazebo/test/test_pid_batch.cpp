@@ -0,0 +1,124 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+// Author: Michael Ferguson
+#include <cmath>
+#include <limits>
+#include <gtest/gtest.h>
+#include <control_toolbox/pid.h>
+#include <ubr1_gazebo/pid_batch.h>
+
+using ubr1_gazebo::PidBatch;
+
+// Run the batch and control_toolbox::Pid side by side
+void compare(double p, double i, double d, double i_max, double i_min,
+             const std::vector<double>& errors, const std::vector<double>& dts)
+{
+  control_toolbox::Pid pid(p, i, d, i_max, i_min);
+  PidBatch batch;
+  batch.resize(3);
+  batch.setGains(1, p, i, d, i_max, i_min);
+
+  for (size_t k = 0; k < errors.size(); ++k)
+  {
+    double expected = pid.computeCommand(errors[k], ros::Duration(dts[k]));
+    double actual = batch.compute(1, errors[k], dts[k]);
+    EXPECT_NEAR(expected, actual, 1e-9) << "step " << k;
+  }
+}
+
+TEST(PidBatch, test_matches_pid)
+{
+  std::vector<double> errors, dts;
+  for (int k = 0; k < 200; ++k)
+  {
+    errors.push_back(std::sin(k * 0.1) + 0.3);
+    dts.push_back(0.001 * (1 + k % 3));
+  }
+  compare(10.0, 2.0, 0.1, 1.0, -1.0, errors, dts);
+}
+
+TEST(PidBatch, test_windup_matches_pid)
+{
+  // A long saturated error winds up the integral far past i_max, it must
+  // then take as long as the Pid to unwind once the error changes sign
+  std::vector<double> errors, dts;
+  for (int k = 0; k < 500; ++k)
+  {
+    errors.push_back(1.0);
+    dts.push_back(0.01);
+  }
+  for (int k = 0; k < 500; ++k)
+  {
+    errors.push_back(-0.5);
+    dts.push_back(0.01);
+  }
+  compare(1.0, 5.0, 0.0, 0.5, -0.5, errors, dts);
+}
+
+TEST(PidBatch, test_bad_input_matches_pid)
+{
+  std::vector<double> errors, dts;
+  double values[] = {0.5, 0.7, std::numeric_limits<double>::quiet_NaN(), 0.2,
+                     std::numeric_limits<double>::infinity(), 0.1, 0.4, 0.3};
+  double steps[] = {0.01, 0.0, 0.01, 0.01, 0.01, -0.01, 0.01, 0.02};
+  for (size_t k = 0; k < sizeof(values) / sizeof(double); ++k)
+  {
+    errors.push_back(values[k]);
+    dts.push_back(steps[k]);
+  }
+  compare(2.0, 1.0, 0.5, 10.0, -10.0, errors, dts);
+}
+
+TEST(PidBatch, test_independent)
+{
+  PidBatch batch;
+  batch.resize(2);
+  batch.setGains(0, 1.0, 1.0, 0.0, 10.0, -10.0);
+  batch.setGains(1, 1.0, 1.0, 0.0, 10.0, -10.0);
+
+  for (int k = 0; k < 10; ++k)
+    batch.compute(0, 1.0, 0.1);
+
+  // Controller 1 has no accumulated integral
+  EXPECT_DOUBLE_EQ(1.1, batch.compute(1, 1.0, 0.1));
+  EXPECT_DOUBLE_EQ(2.1, batch.compute(0, 1.0, 0.1));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
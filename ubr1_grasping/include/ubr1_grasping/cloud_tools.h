@@ -82,6 +82,24 @@ double distancePointToPlane(const PointT& point, const pcl::ModelCoefficients::P
  */
 double distancePointToPlane(const Eigen::Vector4f& point, const pcl::ModelCoefficients::Ptr plane);
 
+/**
+ *  \brief Range filter, transform and voxelize a cloud in a single pass.
+ *  \param input The cloud, in the sensor frame.
+ *  \param transform Transform from the sensor frame to the output frame.
+ *  \param min_range Points with sensor frame z below this are dropped.
+ *  \param max_range Points with sensor frame z above this are dropped.
+ *  \param min_z Points with output frame z below this are dropped.
+ *  \param max_z Points with output frame z above this are dropped.
+ *  \param leaf_size Size of the voxels.
+ *  \param output The centroid of each occupied voxel, with averaged color.
+ */
+void rangeTransformVoxelize(const pcl::PointCloud<pcl::PointXYZRGB>& input,
+                            const Eigen::Affine3f& transform,
+                            float min_range, float max_range,
+                            float min_z, float max_z,
+                            float leaf_size,
+                            pcl::PointCloud<pcl::PointXYZRGB>& output);
+
 }  // namespace ubr1_grasping
 
 #endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_CLOUD_TOOLS_H_
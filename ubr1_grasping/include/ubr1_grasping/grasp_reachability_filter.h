@@ -0,0 +1,167 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_GRASP_REACHABILITY_FILTER_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_GRASP_REACHABILITY_FILTER_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <kdl/chain.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainiksolverpos_nr_jl.hpp>
+#include <kdl/chainiksolvervel_pinv.hpp>
+#include <kdl/jntarray.hpp>
+#include <moveit_msgs/Grasp.h>
+#include <urdf/model.h>
+
+#include <ubr1_grasping/reachability_map.h>
+#include <ubr1_grasping/thread_pool.h>
+
+namespace ubr1_grasping
+{
+
+/**
+ *  \brief Removes grasps the arm cannot reach, before they are sent to MoveIt.
+ *
+ *  The arm chain is loaded once. At startup, random configurations within
+ *  the joint limits are run through forward kinematics to build a voxel map
+ *  of the positions the wrist can reach, each voxel holding a configuration
+ *  that reaches it. A grasp outside the map is rejected immediately, others
+ *  get a short IK solve seeded from their voxel. That seed only reaches the
+ *  position, so the solve is retried from the seeds of the neighboring
+ *  voxels and a few fixed configurations before the grasp is rejected.
+ *  Grasps are checked in parallel, each worker having its own solvers.
+ *
+ *  If a map from build_reachability_map is loaded, poses whose approach
+ *  direction cannot be reached at any torso height are rejected before
+ *  the IK check. When the map is given to init(), it replaces the sampled
+ *  map for rejecting poses, and only a small map is sampled for IK seeds.
+ */
+class GraspReachabilityFilter
+{
+public:
+  /**
+   *  \param resolution Size of a voxel in the reachability map.
+   *  \param samples Number of configurations sampled to build the map.
+   *  \param thread_pool Pool to run IK on, which may be shared with other
+   *         users. If NULL, a pool with one worker per core is created.
+   */
+  GraspReachabilityFilter(double resolution = 0.05,
+                          int samples = 200000,
+                          const boost::shared_ptr<ThreadPool>& thread_pool = boost::shared_ptr<ThreadPool>());
+
+  /**
+   *  \brief Load the chain and build the reachability map.
+   *  \param model The robot model.
+   *  \param root_link Root of the chain, grasps must be in this frame.
+   *  \param tip_link Tip of the chain, the link grasp poses are for.
+   *  \param map_file Optional map from build_reachability_map. If it loads,
+   *         only a small map is sampled at startup, for IK seeds.
+   *  \returns False if the chain could not be loaded.
+   */
+  bool init(const urdf::Model& model,
+            const std::string& root_link,
+            const std::string& tip_link,
+            const std::string& map_file = std::string());
+
+  /**
+   *  \brief Load a reachability map, used to reject grasps before IK.
+   *  \returns False if the map could not be loaded, or is not for this chain.
+   */
+  bool loadMap(const std::string& filename);
+
+  /**
+   *  \brief Remove unreachable grasps.
+   *  \param grasps The grasps to filter. Reachable grasps are kept, sorted
+   *         by decreasing grasp_quality. Grasps that are not in the root
+   *         frame cannot be checked, and are kept.
+   *  \param max_grasps Keep only this many of the best grasps, 0 for all.
+   *  \returns The number of grasps kept.
+   */
+  int filter(std::vector<moveit_msgs::Grasp>& grasps, size_t max_grasps = 0);
+
+  /** \brief Whether the tip can reach a pose, expressed in the root frame. */
+  bool isReachable(const KDL::Frame& pose, unsigned int worker = 0);
+
+private:
+  /** \brief Solvers used by one worker. */
+  struct Solvers
+  {
+    boost::shared_ptr<KDL::ChainFkSolverPos_recursive> fk;
+    boost::shared_ptr<KDL::ChainIkSolverVel_pinv> ik_vel;
+    boost::shared_ptr<KDL::ChainIkSolverPos_NR_JL> ik;
+    KDL::JntArray result;
+  };
+
+  // Index of the voxel containing a point, -1 if outside the map
+  int voxelIndex(const KDL::Vector& p) const;
+
+  // Build map by sampling forward kinematics
+  void buildMap(int samples);
+
+  // Run IK from a seed
+  bool solve(const KDL::JntArray& seed, const KDL::Frame& pose, Solvers& s);
+
+  // Run on the thread pool, check one grasp
+  void checkGrasp(size_t index, unsigned int worker,
+                  const std::vector<moveit_msgs::Grasp>& grasps,
+                  std::vector<char>& keep);
+
+  double resolution_;
+  int samples_;
+
+  std::string root_link_, tip_link_;
+  KDL::Chain chain_;
+  KDL::JntArray q_min_, q_max_;
+
+  // Voxel map, each entry is an index into seeds_, or -1 if not reachable
+  KDL::Vector origin_;
+  int size_x_, size_y_, size_z_;
+  std::vector<int> voxels_;
+  std::vector<KDL::JntArray> seeds_;
+
+  // Seeds tried when the seeds from the map fail
+  std::vector<KDL::JntArray> fallback_seeds_;
+
+  // Optional map of reachable orientations, from build_reachability_map
+  ReachabilityMap map_;
+  bool use_map_;
+
+  boost::shared_ptr<ThreadPool> pool_;
+  std::vector<Solvers> solvers_;
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_GRASP_REACHABILITY_FILTER_H_
@@ -31,16 +31,21 @@
 #ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_OBJECT_SUPPORT_SEGMENTATION_H_
 #define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_OBJECT_SUPPORT_SEGMENTATION_H_
 
+#include <string>
 #include <vector>
 
 #include <grasping_msgs/Object.h>
 
 #include <pcl/io/io.h>
 #include <pcl/point_types.h>
-#include <pcl/segmentation/extract_clusters.h>
-#include <pcl/filters/extract_indices.h>
-#include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/filters/voxel_grid.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/segmentation/organized_multi_plane_segmentation.h>
+#include <ubr1_grasping/parallel_plane_ransac.h>
+#include <ubr1_grasping/shape_extraction.h>
+#include <ubr1_grasping/stage_timer.h>
+#include <ubr1_grasping/thread_pool.h>
+#include <ubr1_grasping/voxel_clustering.h>
 
 namespace ubr1_grasping
 {
@@ -54,10 +59,21 @@ public:
 
   /**
    *  \param cluster_tolerance The minimum separation between two objects.
-   *  \param cluster_min_size The minimum number of points in an object
+   *  \param cluster_min_size The minimum number of points in an object,
+   *         after voxelizing. Organized clouds are not voxelized, their
+   *         minimum is ORGANIZED_CLUSTER_SCALE times larger unless set with
+   *         setOrganizedClusterMinSize().
+   *  \param use_organized Whether to use the organized pipeline (integral
+   *         image normals, multi-plane segmentation and connected components)
+   *         when the input cloud is organized.
+   *  \param thread_pool Pool to fit planes and process clusters on, which
+   *         may be shared with other users. If NULL, a pool with one worker
+   *         per core is created.
    */
   ObjectSupportSegmentation(double cluster_tolerance = 0.01,
-                            int cluster_min_size = 50);
+                            int cluster_min_size = 50,
+                            bool use_organized = false,
+                            const boost::shared_ptr<ThreadPool>& thread_pool = boost::shared_ptr<ThreadPool>());
 
   /**
    *  \brief Split a cloud into objects and supporting surfaces.
@@ -67,19 +83,110 @@ public:
    *  \param supports The vector to fill in with support surfaces found.
    *  \param object_cloud A colored cloud of objects found (if output_clouds).
    *  \param support_cloud A colored cloud of supports found (if output_clouds).
+   *  \param times If not NULL, the time of each stage is added to this.
    */
   bool segment(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
                std::vector<grasping_msgs::Object>& objects,
                std::vector<grasping_msgs::Object>& supports,
                pcl::PointCloud<pcl::PointXYZRGB>& object_cloud,
                pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
-               bool output_clouds);
-  
+               bool output_clouds,
+               StageTimes* times = NULL);
+
+  /**
+   *  \brief Declare that unorganized clouds passed to segment() have already
+   *         been voxelized and limited in height (see rangeTransformVoxelize),
+   *         so the internal voxel grid is skipped.
+   */
+  void setInputVoxelized(bool voxelized);
+
+  /**
+   *  \brief Set the minimum number of points in an object found by the
+   *         organized pipeline, which clusters every pixel rather than
+   *         one point per voxel.
+   */
+  void setOrganizedClusterMinSize(int cluster_min_size);
+
+  /**
+   *  \brief Default ratio of organized to voxelized minimum cluster size.
+   *         A 640x480 camera samples a surface at about 1.7mm at one meter,
+   *         roughly 8 points for each 5mm voxel.
+   */
+  static const int ORGANIZED_CLUSTER_SCALE = 8;
+
+  /** \brief Voxel size used when voxelizing unorganized clouds. */
+  float getLeafSize() const;
+
+  /** \brief Height limits applied before finding supports. */
+  void getHeightLimits(float& min_z, float& max_z) const;
+
 private:
+  /**
+   *  \brief Find supports with iterative RANSAC on a voxelized cloud, then
+   *         cluster the remaining points over a sparse grid.
+   */
+  void segmentUnorganized(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+                          std::vector<grasping_msgs::Object>& supports,
+                          pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+                          bool output_clouds,
+                          std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+                          pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+                          std::vector<pcl::PointIndices>& clusters,
+                          StageTimes* times);
+
+  /**
+   *  \brief Find all supports in one pass over an organized cloud, then
+   *         cluster the remaining points with connected components.
+   */
+  void segmentOrganized(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+                        std::vector<grasping_msgs::Object>& supports,
+                        pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+                        bool output_clouds,
+                        std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+                        pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+                        std::vector<pcl::PointIndices>& clusters,
+                        StageTimes* times);
+
+  /**
+   *  \brief Turn one cluster into an object, run on the thread pool.
+   *  \param index The cluster to process.
+   *  \param worker Index of the worker, selects the scratch buffers.
+   *  \param objects Filled in at index, with valid[index] set if the
+   *         cluster sits on one of the planes.
+   */
+  void extractObject(size_t index,
+                     unsigned int worker,
+                     const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+                     const std::vector<pcl::PointIndices>& clusters,
+                     const std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+                     const std::string& frame_id,
+                     std::vector<grasping_msgs::Object>& objects,
+                     std::vector<char>& valid);
+
+  /** \brief Add a support surface found by either pipeline. */
+  void addSupport(pcl::PointCloud<pcl::PointXYZRGB>& plane,
+                  const pcl::ModelCoefficients::Ptr& coefficients,
+                  const std::string& frame_id,
+                  std::vector<grasping_msgs::Object>& supports,
+                  pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+                  bool output_clouds);
+
+  double cluster_tolerance_;
+  int cluster_min_size_;
+  int organized_cluster_min_size_;
+  bool use_organized_;
+  bool input_voxelized_;
+
   pcl::VoxelGrid<pcl::PointXYZRGB> voxel_grid_;
-  pcl::SACSegmentation<pcl::PointXYZRGB> segment_;
-  pcl::EuclideanClusterExtraction<pcl::PointXYZRGB> extract_clusters_;
-  pcl::ExtractIndices<pcl::PointXYZRGB> extract_indices_;
+  ParallelPlaneRansac segment_;
+  VoxelClustering extract_clusters_;
+
+  // Clusters are processed in parallel, each worker has its own buffers
+  boost::shared_ptr<ThreadPool> thread_pool_;
+  std::vector<ShapeExtractionBuffers> shape_buffers_;
+
+  pcl::IntegralImageNormalEstimation<pcl::PointXYZRGB, pcl::Normal> normal_estimation_;
+  pcl::OrganizedMultiPlaneSegmentation<pcl::PointXYZRGB, pcl::Normal, pcl::Label> multi_plane_segmentation_;
 };
 
 }  // namespace ubr1_grasping
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_PARALLEL_PLANE_RANSAC_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_PARALLEL_PLANE_RANSAC_H_
+
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+#include <boost/shared_ptr.hpp>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/ModelCoefficients.h>
+#include <pcl/PointIndices.h>
+
+#include <ubr1_grasping/thread_pool.h>
+
+namespace ubr1_grasping
+{
+
+/**
+ *  \brief Multi-threaded RANSAC plane fit, with the same interface as
+ *         pcl::SACSegmentation for SACMODEL_PLANE.
+ *
+ *  Hypotheses are drawn from a seeded generator in fixed size batches, and
+ *  each batch is scored on a ThreadPool. The result depends only on the seed
+ *  and the input, not on the number of threads.
+ */
+class ParallelPlaneRansac
+{
+public:
+  ParallelPlaneRansac();
+
+  /** \brief Set the cloud to fit planes in. */
+  void setInputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud);
+
+  /** \brief Only consider these points of the input cloud. */
+  void setIndices(const pcl::PointIndices::ConstPtr& indices);
+
+  /** \brief Maximum distance of an inlier from the plane. */
+  void setDistanceThreshold(double threshold);
+
+  /** \brief Upper bound on the number of hypotheses tested. */
+  void setMaxIterations(int max_iterations);
+
+  /** \brief Probability of choosing at least one outlier free sample. */
+  void setProbability(double probability);
+
+  /** \brief Refit the plane to all inliers with least squares. */
+  void setOptimizeCoefficients(bool optimize);
+
+  /**
+   *  \brief Number of threads to use, 0 to use one per core. The threads
+   *         are created on the next call to segment() and reused after.
+   */
+  void setNumberOfThreads(unsigned int threads);
+
+  /**
+   *  \brief Score hypotheses on a pool shared with other users, rather
+   *         than one owned by this class. segment() must not be called
+   *         from a task running on the same pool.
+   */
+  void setThreadPool(const boost::shared_ptr<ThreadPool>& pool);
+
+  /** \brief Seed for the hypothesis generator. */
+  void setSeed(unsigned int seed);
+
+  /**
+   *  \brief Find the plane with the most inliers.
+   *  \param inliers Indices into the input cloud of points on the plane,
+   *         empty if no plane was found.
+   *  \param coefficients The plane as ax + by + cz + d = 0.
+   */
+  void segment(pcl::PointIndices& inliers, pcl::ModelCoefficients& coefficients);
+
+private:
+  typedef std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f> > PlaneVector;
+
+  /** \brief Plane through three points, false if they are degenerate. */
+  bool computePlane(size_t i0, size_t i1, size_t i2, Eigen::Vector4f& plane) const;
+
+  /** \brief Count points within threshold of a plane. */
+  size_t countInliers(const Eigen::Vector4f& plane) const;
+
+  /** \brief Score one hypothesis of the current batch, run on the pool. */
+  void scoreHypothesis(size_t index);
+
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr input_;
+  pcl::PointIndices::ConstPtr indices_;
+
+  double threshold_;
+  int max_iterations_;
+  double probability_;
+  bool optimize_;
+  unsigned int threads_;
+  unsigned int seed_;
+
+  // Points being fit, structure of arrays so that scoring vectorizes
+  std::vector<float> x_, y_, z_;
+  std::vector<int> point_indices_;
+
+  // Current batch of hypotheses and their scores
+  PlaneVector hypotheses_;
+  std::vector<size_t> scores_;
+
+  // Workers are kept between calls to segment()
+  boost::shared_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_PARALLEL_PLANE_RANSAC_H_
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_REACHABILITY_MAP_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_REACHABILITY_MAP_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <Eigen/Geometry>
+
+namespace ubr1_grasping
+{
+
+/**
+ *  \brief Header of a reachability map file. The file is this header
+ *         followed by size_x * size_y * size_z cells, each a uint64_t
+ *         bitmask of the orientation bins reachable in that voxel, with
+ *         x varying fastest. All values are in host byte order.
+ */
+struct ReachabilityMapHeader
+{
+  char magic[8];             // "UBRREACH"
+  uint32_t version;
+  uint32_t elevation_bins;   // elevation_bins * azimuth_bins <= 64
+  uint32_t azimuth_bins;
+  uint32_t size_x, size_y, size_z;
+  float resolution;
+  float origin[3];           // corner of the first voxel, in frame_id
+  float lift_origin[3];      // origin of frame_id in base_frame_id, lift at zero
+  float lift_axis[3];        // direction frame_id moves as the lift extends
+  float lift_min, lift_max;
+  char frame_id[32];         // frame of the map, the root of the arm
+  char base_frame_id[32];    // frame the lift moves frame_id in
+  char tip_frame_id[32];     // link the map is for
+};
+
+/**
+ *  \brief Which poses the arm can reach, as a voxel grid of orientation
+ *         bitmasks built offline by build_reachability_map.
+ *
+ *  Orientations are binned by the approach direction of the tip (its X
+ *  axis), in bands of equal area, ignoring roll about the approach. A
+ *  query is a couple of multiplies and a bit test. Loading maps the file
+ *  into memory without reading it, so the map can be shared between
+ *  processes at no cost.
+ */
+class ReachabilityMap : boost::noncopyable
+{
+public:
+  ReachabilityMap();
+  ~ReachabilityMap();
+
+  /**
+   *  \brief Create an empty map in memory.
+   *  \param frame_id Frame of the map, the root of the arm.
+   *  \param tip_frame_id Link the map is for.
+   *  \param min_corner Minimum corner of the region covered.
+   *  \param max_corner Maximum corner of the region covered.
+   *  \param resolution Size of a voxel.
+   */
+  void create(const std::string& frame_id,
+              const std::string& tip_frame_id,
+              const Eigen::Vector3f& min_corner,
+              const Eigen::Vector3f& max_corner,
+              float resolution);
+
+  /**
+   *  \brief Describe the prismatic lift moving the map frame, so poses
+   *         in the base frame can be queried.
+   *  \param base_frame_id Frame the lift moves the map frame in.
+   *  \param origin Origin of the map frame in the base frame, at zero lift.
+   *  \param axis Direction the map frame moves as the lift extends.
+   *  \param min Lower limit of the lift.
+   *  \param max Upper limit of the lift.
+   */
+  void setLift(const std::string& base_frame_id,
+               const Eigen::Vector3f& origin,
+               const Eigen::Vector3f& axis,
+               float min, float max);
+
+  /** \brief Mark a tip position and approach direction as reachable. */
+  void add(const Eigen::Vector3f& position, const Eigen::Vector3f& approach);
+
+  /** \brief Write the map to a file. */
+  bool save(const std::string& filename) const;
+
+  /** \brief Map a file written by save() into memory. */
+  bool load(const std::string& filename);
+
+  /** \brief Orientation bitmask of the voxel containing a position, 0 if outside. */
+  uint64_t getMask(const Eigen::Vector3f& position) const
+  {
+    int index = getIndex(position);
+    return (index < 0) ? 0 : cells_[index];
+  }
+
+  /** \brief Bit of the orientation bin containing an approach direction. */
+  uint64_t getOrientationBit(const Eigen::Vector3f& approach) const;
+
+  /** \brief Whether a tip position and approach, in the map frame, are reachable. */
+  bool isReachable(const Eigen::Vector3f& position, const Eigen::Vector3f& approach) const
+  {
+    return (getMask(position) & getOrientationBit(approach)) != 0;
+  }
+
+  /** \brief Whether a tip pose, in the map frame, is reachable. */
+  bool isReachable(const Eigen::Isometry3d& pose) const;
+
+  /** \brief Whether a tip pose, in the base frame, is reachable at this lift. */
+  bool isReachableFromBase(const Eigen::Isometry3d& pose, double lift) const;
+
+  /** \brief Whether a tip pose, in the base frame, is reachable at any lift. */
+  bool isReachableFromBase(const Eigen::Isometry3d& pose) const;
+
+  /** \brief Number of voxels with any reachable orientation. */
+  size_t getReachableCount() const;
+
+  /** \brief Get the header, NULL if no map is loaded. */
+  const ReachabilityMapHeader* getHeader() const
+  {
+    return header_;
+  }
+
+private:
+  int getIndex(const Eigen::Vector3f& position) const
+  {
+    if (!header_)
+      return -1;
+    int x = static_cast<int>((position.x() - header_->origin[0]) * inverse_resolution_);
+    int y = static_cast<int>((position.y() - header_->origin[1]) * inverse_resolution_);
+    int z = static_cast<int>((position.z() - header_->origin[2]) * inverse_resolution_);
+    // Casting truncates toward zero, so check the position is above the origin too
+    if (position.x() < header_->origin[0] || position.y() < header_->origin[1] ||
+        position.z() < header_->origin[2] ||
+        x >= static_cast<int>(header_->size_x) || y >= static_cast<int>(header_->size_y) ||
+        z >= static_cast<int>(header_->size_z))
+      return -1;
+    return (z * header_->size_y + y) * header_->size_x + x;
+  }
+
+  // Release the current map
+  void clear();
+
+  // Either point into the mapped file, or into storage_/header_storage_
+  const ReachabilityMapHeader* header_;
+  const uint64_t* cells_;
+  float inverse_resolution_;
+
+  ReachabilityMapHeader header_storage_;
+  std::vector<uint64_t> storage_;
+
+  void* mapped_;
+  size_t mapped_size_;
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_REACHABILITY_MAP_H_
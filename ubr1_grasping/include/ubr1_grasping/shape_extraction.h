@@ -32,6 +32,9 @@
 #ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_SHAPE_EXTRACTION_H_
 #define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_SHAPE_EXTRACTION_H_
 
+#include <vector>
+
+#include <Eigen/Core>
 #include <shape_msgs/SolidPrimitive.h>
 #include <geometry_msgs/Pose.h>
 
@@ -41,6 +44,16 @@
 namespace ubr1_grasping
 {
 
+/**
+ *  \brief Working memory for extractShape. Passing the same buffers to each
+ *         call avoids allocating for every object, use one per thread.
+ */
+struct ShapeExtractionBuffers
+{
+  std::vector<Eigen::Vector2f> points;  // object projected onto the plane
+  std::vector<Eigen::Vector2f> hull;    // convex hull of the projected object
+};
+
 /**
  *  \brief Find the smallest shape primitive we can fit around this object.
  *  \param input Point Cloud of the object.
@@ -70,6 +83,24 @@ bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
                   shape_msgs::SolidPrimitive& shape,
                   geometry_msgs::Pose& pose);
 
+/**
+ *  \brief Find the smallest shape primitive we can fit around this object, given
+ *         the plane parameters, using preallocated buffers.
+ *  \param input Point Cloud of the object.
+ *  \param model Model coefficients for the plane.
+ *  \param output Point Cloud transformed to the pose frame of the shape primitive fit.
+ *  \param shape Returned smallest shape primitive fit.
+ *  \param pose The pose of the shape primitive fit.
+ *  \param buffers Working memory, reused between calls.
+ *  \returns True if a shape was extracted, false if we have a failure.
+ */
+bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
+                  const pcl::ModelCoefficients::Ptr model,
+                  pcl::PointCloud<pcl::PointXYZRGB>& output,
+                  shape_msgs::SolidPrimitive& shape,
+                  geometry_msgs::Pose& pose,
+                  ShapeExtractionBuffers& buffers);
+
 /**
  *  \brief Find a bounding box around a cloud. This method does not attempt to
  *         find best orientation and so the bounding box will be oriented with
@@ -82,6 +113,45 @@ bool extractUnorientedBoundingBox(const pcl::PointCloud<pcl::PointXYZRGB>& input
                                   shape_msgs::SolidPrimitive& shape,
                                   geometry_msgs::Pose& pose);
 
+/**
+ *  \brief Find the convex hull of a set of points using Andrew's monotone chain.
+ *  \param points The points, these are sorted and duplicates removed in place.
+ *  \param hull Vertices of the hull in counter-clockwise order, starting from
+ *         the lowest, leftmost point. Collinear points are not included.
+ */
+void convexHull2D(std::vector<Eigen::Vector2f>& points,
+                  std::vector<Eigen::Vector2f>& hull);
+
+/**
+ *  \brief Find the minimum area rectangle around a convex polygon using
+ *         rotating calipers. One side of the rectangle is always collinear
+ *         with an edge of the polygon, of these the first is chosen
+ *         (rectangles within 0.01% of the area are considered equal).
+ *  \param hull Vertices of the polygon, in counter-clockwise order.
+ *  \param axis Unit direction of the first side of the rectangle.
+ *  \param min_corner Minimum corner of the rectangle, in the frame where
+ *         axis is the X axis: (axis.dot(p), perpendicular(axis).dot(p)).
+ *  \param max_corner Maximum corner of the rectangle, in the same frame.
+ *  \returns False if hull is empty.
+ */
+bool minimumAreaRectangle(const std::vector<Eigen::Vector2f>& hull,
+                          Eigen::Vector2f& axis,
+                          Eigen::Vector2f& min_corner,
+                          Eigen::Vector2f& max_corner);
+
+/**
+ *  \brief Find the minimum enclosing circle of a set of points using
+ *         Welzl's algorithm, in expected linear time. The points are
+ *         shuffled with a fixed seed, so results are repeatable.
+ *  \param points The points to enclose.
+ *  \param center Center of the circle.
+ *  \param radius Radius of the circle.
+ *  \returns False if points is empty.
+ */
+bool minimumEnclosingCircle(const std::vector<Eigen::Vector2f>& points,
+                            Eigen::Vector2f& center,
+                            float& radius);
+
 }  // namespace ubr1_grasping
 
 #endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_SHAPE_EXTRACTION_H_
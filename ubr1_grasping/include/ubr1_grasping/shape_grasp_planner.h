@@ -32,6 +32,9 @@
 #ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_SHAPE_GRASP_PLANNER_H_
 #define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_SHAPE_GRASP_PLANNER_H_
 
+#include <vector>
+
+#include <Eigen/Geometry>
 #include <grasping_msgs/GraspableObject.h>
 
 namespace ubr1_grasping
@@ -39,11 +42,14 @@ namespace ubr1_grasping
 
 /**
  *  \brief A simple grasp planner that uses the bounding box shape to
- *         generate viable grasps.
+ *         generate viable grasps. Planning holds no state, so plan() can
+ *         be called from several threads at once.
  */
 class ShapeGraspPlanner
 {
 public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   ShapeGraspPlanner(double gripper_max_opening,
                     double gripper_finger_depth);
 
@@ -51,40 +57,68 @@ public:
                    std::vector<moveit_msgs::Grasp>& grasps);
 
 private:
-  /**
-   *  \brief Generate a grasp, add it to internal grasps_
-   *  \param pose The pose of the end effector tool point
-   *  \param gripper_pitch The pitch of the gripper on approach
-   *  \param x_offset The offset in the x direction (in).
-   *  \param z_offset The offset in the z direction (up).
-   *  \param quality The quality to ascribe to this grasp.
-   *  \returns The number of grasps generated.
-   */
-  int createGrasp(const geometry_msgs::PoseStamped& pose,
-                  double gripper_pitch,
-                  double x_offset,
-                  double z_offset,
-                  double quality);
+  /** \brief Gripper pitches used when approaching an object. */
+  enum GripperPitch
+  {
+    PITCH_HORIZONTAL,    // 0.0
+    PITCH_ANGLED_UP,     // 0.5
+    PITCH_CORNER,        // 1.57/2
+    PITCH_ANGLED_DOWN,   // 1.07
+    PITCH_VERTICAL,      // 1.57
+    NUM_PITCHES
+  };
+
+  /** \brief A grasp before it is turned into a message. */
+  struct Candidate
+  {
+    Candidate(int pitch, double x_offset, double z_offset, double quality) :
+      pitch(pitch), x_offset(x_offset), z_offset(z_offset), quality(quality)
+    {
+    }
+
+    int pitch;
+    double x_offset, z_offset;
+    double quality;
+  };
 
   /**
    *  \brief Generate a series of grasps around the edge of a shape
-   *  \param pose The pose of the end effector tool point.
    *  \param depth The depth of the shape.
    *  \param width The width of the shape.
    *  \param height The height of the shape.
+   *  \param candidates The vector to add the grasps to.
    *  \param use_vertical Whether to include vertical poses. If coming
    *         from two sides, the second call probably should not generate
    *         vertical poses.
    *  \returns The number of grasps generated.
    */
-  int createGraspSeries(const geometry_msgs::PoseStamped& pose,
-                        double depth, double width, double height,
-                        bool use_vertical = true);
+  int createGraspSeries(double depth, double width, double height,
+                        std::vector<Candidate>& candidates,
+                        bool use_vertical = true) const;
+
+  /**
+   *  \brief Turn candidates into grasps
+   *  \param header Header for the grasp poses.
+   *  \param pose The pose of the end effector tool point, facing this side.
+   *  \param candidates The grasps to generate for this side.
+   *  \param grasps The vector to add the grasps to.
+   */
+  void createGrasps(const std_msgs::Header& header,
+                    const Eigen::Isometry3d& pose,
+                    const std::vector<Candidate>& candidates,
+                    std::vector<moveit_msgs::Grasp>& grasps) const;
 
   double max_opening_, finger_depth_;
 
-  // storing of internal grasps as we generate them
-  std::vector<moveit_msgs::Grasp> grasps_;
+  // Tool point -> wrist_roll_link for each pitch, excluding the x/z offset
+  Eigen::Isometry3d pitch_offsets_[NUM_PITCHES];
+
+  // Rotation from one side of the object to the next
+  Eigen::Isometry3d side_rotation_;
+
+  // Grasp with the postures and translations filled in, which are the same
+  //  for every grasp. Each grasp is a copy of this with the pose set.
+  moveit_msgs::Grasp grasp_template_;
 };
 
 }  // namespace ubr1_grasping
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_STAGE_TIMER_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_STAGE_TIMER_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <ros/time.h>
+
+namespace ubr1_grasping
+{
+
+/** \brief Stages of finding objects and planning grasps, in the order they run. */
+enum Stage
+{
+  STAGE_WAIT,            // waiting for a cloud to arrive
+  STAGE_RANGE_FILTER,    // range filter of organized clouds
+  STAGE_TRANSFORM,       // tf lookup, and transform of organized clouds
+  STAGE_VOXELIZE,        // range filter, transform and voxelize of unorganized clouds
+  STAGE_NORMALS,         // height limits and normals of organized clouds
+  STAGE_PLANES,          // finding support planes
+  STAGE_CLUSTERING,      // clustering points that are not supports
+  STAGE_SHAPES,          // fitting shapes to clusters
+  STAGE_GRASP_PLANNING,  // ShapeGraspPlanner::plan for all objects
+  STAGE_REACHABILITY,    // GraspReachabilityFilter::filter for all objects
+  NUM_STAGES
+};
+
+/** \brief Name of a stage, as used in diagnostics. */
+const char* getStageName(int stage);
+
+/**
+ *  \brief Time spent in each stage of one run. Stages that did not run
+ *         are negative.
+ */
+struct StageTimes
+{
+  StageTimes()
+  {
+    clear();
+  }
+
+  void clear()
+  {
+    for (int i = 0; i < NUM_STAGES; ++i)
+      ms[i] = -1.0;
+  }
+
+  /** \brief Add time to a stage, a stage can be timed in several pieces. */
+  void add(int stage, double elapsed_ms)
+  {
+    ms[stage] = (ms[stage] < 0.0) ? elapsed_ms : ms[stage] + elapsed_ms;
+  }
+
+  double ms[NUM_STAGES];
+};
+
+/**
+ *  \brief Adds the time until it goes out of scope to a stage. When times
+ *         is NULL, timing is disabled and the clock is never read.
+ */
+class ScopedStageTimer
+{
+public:
+  ScopedStageTimer(StageTimes* times, int stage) :
+    times_(times), stage_(stage)
+  {
+    if (times_)
+      start_ = ros::WallTime::now();
+  }
+
+  ~ScopedStageTimer()
+  {
+    stop();
+  }
+
+  /** \brief Stop timing before the end of the scope. */
+  void stop()
+  {
+    if (times_)
+      times_->add(stage_, 1000.0 * (ros::WallTime::now() - start_).toSec());
+    times_ = NULL;
+  }
+
+private:
+  StageTimes* times_;
+  int stage_;
+  ros::WallTime start_;
+};
+
+/**
+ *  \brief Latency of each stage over the most recent runs. Runs can be
+ *         added from several threads.
+ */
+class StageStatistics
+{
+public:
+  /** \param window Number of recent runs kept for each stage. */
+  explicit StageStatistics(size_t window = 100);
+
+  /** \brief Add the stages that ran. */
+  void add(const StageTimes& times);
+
+  /**
+   *  \brief Summarize each stage as count, mean and percentiles.
+   *  \param status Status to fill in, keeps the name and hardware_id.
+   */
+  void getStatus(diagnostic_msgs::DiagnosticStatus& status);
+
+private:
+  boost::mutex mutex_;
+  size_t window_;
+  std::vector<double> samples_[NUM_STAGES];  // ring buffers
+  size_t next_[NUM_STAGES];
+  unsigned long count_[NUM_STAGES];          // since startup
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_STAGE_TIMER_H_
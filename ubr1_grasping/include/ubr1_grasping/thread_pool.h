@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_THREAD_POOL_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_THREAD_POOL_H_
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace ubr1_grasping
+{
+
+/**
+ *  \brief A fixed set of threads that run a task over a range of indices.
+ *
+ *  Each call to task gets the index to work on and the number of the worker
+ *  running it, in [0, size()), so per-worker scratch space can be indexed
+ *  without locking. The thread calling run() is worker 0.
+ */
+class ThreadPool
+{
+public:
+  typedef boost::function<void(size_t index, unsigned int worker)> Task;
+
+  /** \param threads Number of workers, 0 for one per core. */
+  explicit ThreadPool(unsigned int threads = 0) :
+    size_(threads > 0 ? threads : std::max(1u, boost::thread::hardware_concurrency())),
+    count_(0),
+    next_(0),
+    finished_(0),
+    generation_(0),
+    shutdown_(false)
+  {
+    for (unsigned int t = 1; t < size_; ++t)
+      threads_.create_thread(boost::bind(&ThreadPool::workerThread, this, t));
+  }
+
+  ~ThreadPool()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      shutdown_ = true;
+    }
+    start_cond_.notify_all();
+    threads_.join_all();
+  }
+
+  /** \brief Number of workers, including the caller of run(). */
+  unsigned int size() const
+  {
+    return size_;
+  }
+
+  /**
+   *  \brief Call task for every index in [0, count), blocking until all are
+   *         done. Calls from several threads are run one after another.
+   */
+  void run(size_t count, const Task& task)
+  {
+    boost::mutex::scoped_lock run_lock(run_mutex_);
+    if (count == 0)
+      return;
+
+    if (size_ == 1 || count == 1)
+    {
+      for (size_t i = 0; i < count; ++i)
+        task(i, 0);
+      return;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      task_ = task;
+      count_ = count;
+      next_ = 0;
+      finished_ = 0;
+      ++generation_;
+    }
+    start_cond_.notify_all();
+
+    work(0);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    while (finished_ < size_ - 1)
+      done_cond_.wait(lock);
+    task_.clear();
+  }
+
+private:
+  void workerThread(unsigned int worker)
+  {
+    unsigned long seen = 0;
+    while (true)
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (generation_ == seen && !shutdown_)
+          start_cond_.wait(lock);
+        if (shutdown_)
+          return;
+        seen = generation_;
+      }
+
+      work(worker);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      if (++finished_ == size_ - 1)
+        done_cond_.notify_all();
+    }
+  }
+
+  void work(unsigned int worker)
+  {
+    while (true)
+    {
+      size_t index;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        if (next_ >= count_)
+          return;
+        index = next_++;
+      }
+      task_(index, worker);
+    }
+  }
+
+  boost::mutex run_mutex_;  // one run() at a time
+  boost::mutex mutex_;      // protects everything below
+  boost::condition_variable start_cond_;
+  boost::condition_variable done_cond_;
+  boost::thread_group threads_;
+
+  unsigned int size_;
+  Task task_;
+  size_t count_;
+  size_t next_;
+  unsigned int finished_;
+  unsigned long generation_;
+  bool shutdown_;
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_THREAD_POOL_H_
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#ifndef UBR1_GRASPING_INCLUDE_UBR1_GRASPING_VOXEL_CLUSTERING_H_
+#define UBR1_GRASPING_INCLUDE_UBR1_GRASPING_VOXEL_CLUSTERING_H_
+
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+
+namespace ubr1_grasping
+{
+
+/**
+ *  \brief Euclidean clustering by connected components over a sparse grid,
+ *         with the same interface as pcl::EuclideanClusterExtraction.
+ *
+ *  Points are bucketed into cells the size of the cluster tolerance, so
+ *  every neighbor of a point is in its own or an adjacent cell. Points within
+ *  tolerance are joined with union-find. For clouds of bounded density, such
+ *  as voxelized clouds, this is linear in the number of points. Clusters are
+ *  the same as those of pcl::EuclideanClusterExtraction.
+ */
+class VoxelClustering
+{
+public:
+  VoxelClustering();
+
+  /** \brief Set the cloud to cluster. */
+  void setInputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud);
+
+  /** \brief Only cluster these points of the input cloud. */
+  void setIndices(const pcl::PointIndices::ConstPtr& indices);
+
+  /**
+   *  \brief Points closer than this are neighbors. As with
+   *         pcl::EuclideanClusterExtraction, points exactly this far apart are not.
+   */
+  void setClusterTolerance(double tolerance);
+
+  /** \brief Clusters with fewer points are discarded. */
+  void setMinClusterSize(int min_size);
+
+  /** \brief Clusters with more points are discarded. */
+  void setMaxClusterSize(int max_size);
+
+  /**
+   *  \brief Find clusters.
+   *  \param clusters Indices into the input cloud of each cluster, sorted
+   *         by decreasing size.
+   */
+  void extract(std::vector<pcl::PointIndices>& clusters);
+
+private:
+  /** \brief Find root of a point, with path halving. */
+  int find(int i);
+
+  /** \brief Join the sets of two points. */
+  void join(int i, int j);
+
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr input_;
+  pcl::PointIndices::ConstPtr indices_;
+
+  double tolerance_;
+  int min_size_;
+  int max_size_;
+
+  // Scratch, reused between calls
+  std::vector<int> parent_;
+  std::vector<int> rank_;
+  std::vector<int> cell_of_point_;
+  std::vector<int> cell_start_;
+  std::vector<int> cell_points_;
+};
+
+}  // namespace ubr1_grasping
+
+#endif  // UBR1_GRASPING_INCLUDE_UBR1_GRASPING_VOXEL_CLUSTERING_H_
@@ -29,12 +29,20 @@
 
 // Author: Michael Ferguson
 
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <ros/ros.h>
 #include <actionlib/server/simple_action_server.h>
 #include <tf/transform_listener.h>
 
+#include <ubr1_grasping/cloud_tools.h>
+#include <ubr1_grasping/grasp_reachability_filter.h>
 #include <ubr1_grasping/object_support_segmentation.h>
 #include <ubr1_grasping/shape_grasp_planner.h>
+#include <ubr1_grasping/stage_timer.h>
+#include <ubr1_grasping/thread_pool.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <grasping_msgs/FindGraspableObjectsAction.h>
 
 #include <pcl_ros/point_cloud.h>
@@ -76,8 +84,88 @@ public:
     int cluster_min_size = 50;
     nh_.getParam("cluster_min_size", cluster_min_size);
 
+    // use_organized: segment organized clouds without voxelizing them
+    use_organized_ = false;
+    nh_.getParam("use_organized", use_organized_);
+
+    // threads: number of threads for segmentation, grasp planning and reachability, 0 for one per core
+    int threads = 0;
+    nh_.getParam("threads", threads);
+    thread_pool_.reset(new ThreadPool(std::max(0, threads)));
+
+    // reachability/enabled: remove grasps the arm cannot reach
+    bool use_reachability = false;
+    max_grasps_ = 0;
+    nh_.param("reachability/enabled", use_reachability, false);
+    if (use_reachability)
+    {
+      std::string root_link, tip_link;
+      double resolution;
+      int samples;
+      nh_.param<std::string>("reachability/root_link", root_link, "base_link");
+      nh_.param<std::string>("reachability/tip_link", tip_link, "wrist_roll_link");
+      nh_.param("reachability/resolution", resolution, 0.05);
+      nh_.param("reachability/samples", samples, 200000);
+      // reachability/top_k: number of grasps to return per object, 0 for all
+      nh_.param("reachability/top_k", max_grasps_, 10);
+
+      // reachability/map_file: map from build_reachability_map, to reject grasps
+      //  before IK, replaces the map otherwise sampled at startup
+      std::string map_file;
+      nh_.getParam("reachability/map_file", map_file);
+
+      urdf::Model model;
+      boost::shared_ptr<GraspReachabilityFilter> filter(
+        new GraspReachabilityFilter(resolution, samples, thread_pool_));
+      if (!model.initParam("robot_description"))
+        ROS_ERROR("Failed to parse URDF, grasps will not be checked for reachability");
+      else if (filter->init(model, root_link, tip_link, map_file))
+        reachability_filter_ = filter;
+    }
+
     // Create perception
-    segmentation_.reset(new ObjectSupportSegmentation(cluster_tolerance, cluster_min_size));
+    segmentation_.reset(new ObjectSupportSegmentation(cluster_tolerance, cluster_min_size, use_organized_,
+                                                      thread_pool_));
+
+    // cluster_min_size_organized: minimum size of an object in a full resolution organized cloud
+    int cluster_min_size_organized;
+    if (nh_.getParam("cluster_min_size_organized", cluster_min_size_organized))
+      segmentation_->setOrganizedClusterMinSize(cluster_min_size_organized);
+
+    // Unorganized clouds are voxelized as they are transformed
+    segmentation_->setInputVoxelized(!use_organized_);
+
+    // continuous: segment clouds in the background, so requests can be answered immediately
+    continuous_ = false;
+    nh_.getParam("continuous", continuous_);
+    double continuous_rate = 2.0;
+    nh_.getParam("continuous_rate", continuous_rate);
+    continuous_period_ = ros::Duration(1.0 / continuous_rate);
+
+    // max_result_age: oldest background result that will be returned for a request
+    double max_result_age = 0.5;
+    nh_.getParam("max_result_age", max_result_age);
+    max_result_age_ = ros::Duration(max_result_age);
+
+    // timing/enabled: time each stage, and publish latencies on /diagnostics
+    timing_ = false;
+    nh_.getParam("timing/enabled", timing_);
+    attach_timing_ = false;
+    if (timing_)
+    {
+      // timing/attach_to_result: add the stage times of each request to the result
+      nh_.getParam("timing/attach_to_result", attach_timing_);
+      // timing/window: number of recent runs latencies are computed over
+      int window = 100;
+      nh_.getParam("timing/window", window);
+      // timing/publish_rate: rate of publishing latencies
+      double publish_rate = 1.0;
+      nh_.getParam("timing/publish_rate", publish_rate);
+      stage_statistics_.reset(new StageStatistics(std::max(1, window)));
+      diagnostics_pub_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+      diagnostics_timer_ = nh_.createTimer(ros::Duration(1.0 / publish_rate),
+                                           &BasicGraspingPerception::diagnosticsCallback, this);
+    }
 
     // Advertise an action for perception + planning
     server_.reset(new server_t(nh_, "find_objects",
@@ -94,6 +182,7 @@ public:
     // Range filter for cloud
     range_filter_.setFilterFieldName("z");
     range_filter_.setFilterLimits(0, 2.5);
+    range_filter_.setKeepOrganized(use_organized_);
 
     // Subscribe to head camera cloud
     cloud_sub_ = nh_.subscribe< pcl::PointCloud<pcl::PointXYZRGB> >("/head_camera/depth_registered/points",
@@ -110,29 +199,86 @@ public:
 private:
   void cloudCallback(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud)
   {
-    // be lazy
-    if (!find_objects_)
-      return;
+    ros::Time stamp = pcl_conversions::fromPCL(cloud->header).stamp;
+
+    // Time went backwards (bag restarted or simulation reset), old results are from the future
+    if (stamp < last_processed_)
+    {
+      last_processed_ = ros::Time();
+      boost::mutex::scoped_lock lock(result_mutex_);
+      result_stamp_ = ros::Time();
+    }
+
+    // be lazy, unless running continuously, a cloud captured before the request cannot answer it
+    bool requested;
+    {
+      boost::mutex::scoped_lock lock(result_mutex_);
+      requested = find_objects_ && stamp >= request_stamp_;
+    }
+    if (!requested)
+    {
+      if (!continuous_ || stamp - last_processed_ < continuous_period_)
+        return;
+    }
+    last_processed_ = stamp;
 
     ROS_DEBUG("Cloud recieved with %d points.", static_cast<int>(cloud->points.size()));
 
-    // Filter out noisy long-range points
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filtered(new pcl::PointCloud<pcl::PointXYZRGB>);
-    range_filter_.setInputCloud(cloud);
-    range_filter_.filter(*cloud_filtered);
-    ROS_DEBUG("Filtered for range, now %d points.", static_cast<int>(cloud_filtered->points.size()));
+    StageTimes cloud_times;
+    StageTimes* times = timing_ ? &cloud_times : NULL;
 
-    // Transform to grounded
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_transformed(new pcl::PointCloud<pcl::PointXYZRGB>);
-    if (!pcl_ros::transformPointCloud(world_frame_, *cloud_filtered, *cloud_transformed, listener_))
+    if (use_organized_)
+    {
+      // Filter out noisy long-range points
+      ScopedStageTimer range_filter_timer(times, STAGE_RANGE_FILTER);
+      pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filtered(new pcl::PointCloud<pcl::PointXYZRGB>);
+      range_filter_.setInputCloud(cloud);
+      range_filter_.filter(*cloud_filtered);
+      range_filter_timer.stop();
+      ROS_DEBUG("Filtered for range, now %d points.", static_cast<int>(cloud_filtered->points.size()));
+
+      // Transform to grounded
+      ScopedStageTimer transform_timer(times, STAGE_TRANSFORM);
+      if (!pcl_ros::transformPointCloud(world_frame_, *cloud_filtered, *cloud_transformed, listener_))
+      {
+        ROS_ERROR("Error transforming to frame %s", world_frame_.c_str());
+        return;
+      }
+    }
+    else
     {
-      ROS_ERROR("Error transforming to frame %s", world_frame_.c_str());
-      return;
+      // Range filter, transform to grounded and voxelize in one pass
+      ScopedStageTimer transform_timer(times, STAGE_TRANSFORM);
+      tf::StampedTransform transform;
+      try
+      {
+        listener_.lookupTransform(world_frame_, cloud->header.frame_id, stamp, transform);
+      }
+      catch (tf::TransformException& ex)
+      {
+        ROS_ERROR("Error transforming to frame %s: %s", world_frame_.c_str(), ex.what());
+        return;
+      }
+      Eigen::Matrix4f matrix;
+      pcl_ros::transformAsMatrix(transform, matrix);
+      transform_timer.stop();
+
+      ScopedStageTimer voxelize_timer(times, STAGE_VOXELIZE);
+      double min_range, max_range;
+      range_filter_.getFilterLimits(min_range, max_range);
+      float min_z, max_z;
+      segmentation_->getHeightLimits(min_z, max_z);
+      rangeTransformVoxelize(*cloud, Eigen::Affine3f(matrix), min_range, max_range,
+                             min_z, max_z, segmentation_->getLeafSize(), *cloud_transformed);
+      cloud_transformed->header = cloud->header;
+      cloud_transformed->header.frame_id = world_frame_;
+      ROS_DEBUG("Filtered and voxelized, now %d points.", static_cast<int>(cloud_transformed->points.size()));
     }
 
     // Run segmentation
-    objects_.clear();
-    supports_.clear();
+    std::vector<grasping_msgs::Object> objects;
+    std::vector<grasping_msgs::Object> supports;
     pcl::PointCloud<pcl::PointXYZRGB> object_cloud;
     pcl::PointCloud<pcl::PointXYZRGB> support_cloud;
     if (debug_)
@@ -140,55 +286,166 @@ private:
       object_cloud.header.frame_id = cloud_transformed->header.frame_id;
       support_cloud.header.frame_id = cloud_transformed->header.frame_id;
     }
-    segmentation_->segment(cloud_transformed, objects_, supports_, object_cloud, support_cloud, debug_);
+    segmentation_->segment(cloud_transformed, objects, supports, object_cloud, support_cloud, debug_, times);
+
+    // Store result, with the time the data was captured
+    {
+      boost::mutex::scoped_lock lock(result_mutex_);
+      objects_.swap(objects);
+      supports_.swap(supports);
+      result_stamp_ = stamp;
+      result_times_ = cloud_times;
+    }
+    if (timing_)
+      stage_statistics_->add(cloud_times);
 
     if (debug_)
     {
       object_cloud_pub_.publish(object_cloud);
       support_cloud_pub_.publish(support_cloud);
     }
-
-    // Ok to continue processing
-    find_objects_ = false;
   }
 
   void executeCallback(const grasping_msgs::FindGraspableObjectsGoalConstPtr& goal)
   {
     grasping_msgs::FindGraspableObjectsResult result;
 
-    // Get objects
-    find_objects_ = true;
-    ros::Time t = ros::Time::now();
-    while (find_objects_ == true)
+    // Use the background result if it is recent enough
+    bool have_result = false;
+    if (continuous_)
+    {
+      boost::mutex::scoped_lock lock(result_mutex_);
+      have_result = !result_stamp_.isZero() && (ros::Time::now() - result_stamp_ <= max_result_age_);
+    }
+
+    // Stages of the cloud are timed in cloudCallback, the rest here
+    StageTimes request_times;
+    StageTimes* times = timing_ ? &request_times : NULL;
+
+    // Get objects, from a cloud captured no earlier than this request
+    ScopedStageTimer wait_timer(times, STAGE_WAIT);
+    if (!have_result)
     {
-      ros::Duration(1/50.0).sleep();
-      if (ros::Time::now() - t > ros::Duration(3.0))
+      ros::Time t = ros::Time::now();
       {
-        find_objects_ = false;
-        server_->setAborted(result, "Failed to get camera data in alloted time.");
-        ROS_ERROR("Failed to get camera data in alloted time.");
-        return;
+        boost::mutex::scoped_lock lock(result_mutex_);
+        request_stamp_ = t;
+        find_objects_ = true;
       }
+      while (!haveResultSince(t))
+      {
+        ros::Duration(1/50.0).sleep();
+        if (ros::Time::now() - t > ros::Duration(3.0))
+        {
+          {
+            boost::mutex::scoped_lock lock(result_mutex_);
+            find_objects_ = false;
+          }
+          server_->setAborted(result, "Failed to get camera data in alloted time.");
+          ROS_ERROR("Failed to get camera data in alloted time.");
+          wait_timer.stop();
+          if (timing_)
+            stage_statistics_->add(request_times);
+          return;
+        }
+      }
+      boost::mutex::scoped_lock lock(result_mutex_);
+      find_objects_ = false;
+    }
+    wait_timer.stop();
+
+    // Copy out results, background segmentation may replace them
+    std::vector<grasping_msgs::Object> objects;
+    StageTimes cloud_times;
+    {
+      boost::mutex::scoped_lock lock(result_mutex_);
+      objects = objects_;
+      result.support_surfaces = supports_;
+      cloud_times = result_times_;
     }
 
     // Set object results
-    for (size_t i = 0; i < objects_.size(); ++i)
+    result.objects.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+      result.objects[i].object = objects[i];
+
+    if (goal->plan_grasps)
+    {
+      // Plan grasps for all objects in parallel
+      ScopedStageTimer planning_timer(times, STAGE_GRASP_PLANNING);
+      thread_pool_->run(result.objects.size(),
+                        boost::bind(&BasicGraspingPerception::planGrasps, this, _1,
+                                    boost::ref(result.objects)));
+      planning_timer.stop();
+
+      // Check all grasps of an object in one batch
+      if (reachability_filter_)
+      {
+        ScopedStageTimer reachability_timer(times, STAGE_REACHABILITY);
+        for (size_t i = 0; i < result.objects.size(); ++i)
+          reachability_filter_->filter(result.objects[i].grasps, std::max(0, max_grasps_));
+      }
+    }
+
+    if (timing_)
     {
-      grasping_msgs::GraspableObject g;
-      g.object = objects_[i];
-      if (goal->plan_grasps)
+      stage_statistics_->add(request_times);
+
+      // Times of the cloud this result came from, and of this request
+      if (attach_timing_)
       {
-        // Plan grasps for object
-        planner_->plan(objects_[i], g.grasps);
+        for (int i = 0; i < NUM_STAGES; ++i)
+        {
+          if (request_times.ms[i] < 0.0)
+            request_times.ms[i] = cloud_times.ms[i];
+        }
+        for (size_t i = 0; i < result.objects.size(); ++i)
+          addTimingProperties(request_times, result.objects[i].object.properties);
+        for (size_t i = 0; i < result.support_surfaces.size(); ++i)
+          addTimingProperties(request_times, result.support_surfaces[i].properties);
       }
-      result.objects.push_back(g);
     }
-    // Set support surfaces
-    result.support_surfaces = supports_;
 
     server_->setSucceeded(result, "Succeeded.");
   }
 
+  // Has a cloud captured at or after stamp been segmented?
+  bool haveResultSince(const ros::Time& stamp)
+  {
+    boost::mutex::scoped_lock lock(result_mutex_);
+    return !result_stamp_.isZero() && result_stamp_ >= stamp;
+  }
+
+  // Add stage times as "latency/<stage>" properties, in ms
+  void addTimingProperties(const StageTimes& times, std::vector<grasping_msgs::ObjectProperty>& properties)
+  {
+    for (int i = 0; i < NUM_STAGES; ++i)
+    {
+      if (times.ms[i] < 0.0)
+        continue;
+      grasping_msgs::ObjectProperty property;
+      property.name = std::string("latency/") + getStageName(i);
+      property.value = boost::lexical_cast<std::string>(times.ms[i]);
+      properties.push_back(property);
+    }
+  }
+
+  void diagnosticsCallback(const ros::TimerEvent&)
+  {
+    diagnostic_msgs::DiagnosticArray msg;
+    msg.header.stamp = ros::Time::now();
+    msg.status.resize(1);
+    msg.status[0].name = "basic_grasping_perception: latency";
+    stage_statistics_->getStatus(msg.status[0]);
+    diagnostics_pub_.publish(msg);
+  }
+
+  // Plan grasps for one object, run on the planner pool
+  void planGrasps(size_t index, std::vector<grasping_msgs::GraspableObject>& objects)
+  {
+    planner_->plan(objects[index].object, objects[index].grasps);
+  }
+
   ros::NodeHandle nh_;
 
   bool debug_;
@@ -197,18 +454,38 @@ private:
   std::string world_frame_;
 
   bool find_objects_;
+  ros::Time request_stamp_;
   std::vector<grasping_msgs::Object> objects_;
   std::vector<grasping_msgs::Object> supports_;
+  ros::Time result_stamp_;
+  StageTimes result_times_;
+  boost::mutex result_mutex_;
+
+  bool use_organized_;
+  bool continuous_;
+  ros::Duration continuous_period_;
+  ros::Duration max_result_age_;
+  ros::Time last_processed_;
 
   ros::Subscriber cloud_sub_;
   ros::Publisher object_cloud_pub_;
   ros::Publisher support_cloud_pub_;
 
   boost::shared_ptr<ShapeGraspPlanner> planner_;
+  // One pool for all parallel work, runs from the cloud and action callbacks take turns
+  boost::shared_ptr<ThreadPool> thread_pool_;
+  boost::shared_ptr<GraspReachabilityFilter> reachability_filter_;
+  int max_grasps_;
   boost::shared_ptr<ObjectSupportSegmentation> segmentation_;
 
   boost::shared_ptr<server_t> server_;
 
+  bool timing_;
+  bool attach_timing_;
+  boost::shared_ptr<StageStatistics> stage_statistics_;
+  ros::Publisher diagnostics_pub_;
+  ros::Timer diagnostics_timer_;
+
   pcl::PassThrough<pcl::PointXYZRGB> range_filter_;
 };
 
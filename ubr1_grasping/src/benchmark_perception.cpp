@@ -0,0 +1,391 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * Copyright 2013, Michael E. Ferguson
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * The names of the authors may not be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+// Author: Michael Ferguson
+
+/*
+ * Replay recorded head camera clouds through the whole perception pipeline,
+ * as basic_grasping_perception runs it but without a ROS master: range
+ * filter and transform (voxelizing unorganized clouds in the same pass),
+ * ObjectSupportSegmentation::segment, extractShape and ShapeGraspPlanner.
+ * Organized clouds are run through both the organized and unorganized
+ * pipelines. Latency of each stage is reported as a distribution over the
+ * iterations, along with peak memory, as a table and optionally as JSON so
+ * results can be compared from release to release. The stages inside
+ * segment() are broken out using the same timers as the node.
+ *
+ * Usage: benchmark_perception [-n iterations] [-j threads] [-o results.json]
+ *                             [-t x y z roll pitch yaw] cloud.pcd [cloud.pcd ...]
+ *
+ * The -t option gives the pose of the camera in base_link, for clouds saved
+ * in the camera frame. Without it, clouds should already be in a frame
+ * where the XY plane is horizontal.
+ *
+ * The run_benchmark_perception target runs this on the head camera clouds
+ * in test/data (organized and unorganized, with few objects and with
+ * clutter), which are generated by test/data/generate_clouds.py, and
+ * writes benchmark_perception.json in the build directory.
+ */
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+#include <ros/ros.h>
+#include <pcl/common/transforms.h>
+#include <pcl/filters/passthrough.h>
+#include <pcl/io/pcd_io.h>
+#include <ubr1_grasping/cloud_tools.h>
+#include <ubr1_grasping/object_support_segmentation.h>
+#include <ubr1_grasping/shape_grasp_planner.h>
+#include <ubr1_grasping/stage_timer.h>
+#include <ubr1_grasping/thread_pool.h>
+
+using ubr1_grasping::ObjectSupportSegmentation;
+using ubr1_grasping::ShapeGraspPlanner;
+
+/** \brief The steps timed, in the order they run. */
+enum Step
+{
+  STEP_FILTER,      // range filter and transform, and voxelization if unorganized
+  STEP_SEGMENT,     // ObjectSupportSegmentation::segment, all of the next four
+  STEP_NORMALS,     // height limits and normals, organized only
+  STEP_PLANES,      // finding supports
+  STEP_CLUSTERING,  // clustering the rest
+  STEP_SHAPES,      // extractShape for all clusters
+  STEP_PLAN,        // ShapeGraspPlanner::plan for all objects
+  STEP_TOTAL,       // filter + segment + plan, as the node runs them
+  NUM_STEPS
+};
+
+const char* STEP_NAMES[NUM_STEPS] =
+  {"filter", "segment", "normals", "planes", "clustering", "shapes", "plan", "total"};
+
+// Steps timed inside segment(), and the stage the segmentation times them as
+const int SEGMENT_STEPS[4][2] =
+{
+  {STEP_NORMALS, ubr1_grasping::STAGE_NORMALS},
+  {STEP_PLANES, ubr1_grasping::STAGE_PLANES},
+  {STEP_CLUSTERING, ubr1_grasping::STAGE_CLUSTERING},
+  {STEP_SHAPES, ubr1_grasping::STAGE_SHAPES}
+};
+
+/** \brief Latency distribution of one stage, in ms. */
+struct Distribution
+{
+  double mean, min, p50, p90, p99, max;
+};
+
+/** \brief Results of one cloud through one pipeline. */
+struct Result
+{
+  std::string file;
+  std::string pipeline;
+  size_t points;
+  size_t objects, supports, grasps;
+  Distribution steps[NUM_STEPS];
+  bool ran[NUM_STEPS];
+  long peak_rss_kb;  // of the whole process, after this run
+};
+
+double elapsedMs(const ros::WallTime& start)
+{
+  return 1000.0 * (ros::WallTime::now() - start).toSec();
+}
+
+/** \brief Peak resident memory of the process, in kilobytes. */
+long peakMemory()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+  return usage.ru_maxrss;
+}
+
+/** \brief Summarize samples, using the nearest rank for percentiles. */
+Distribution summarize(std::vector<double> samples)
+{
+  Distribution d;
+  std::sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  d.mean = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    d.mean += samples[i] / n;
+  d.min = samples.front();
+  d.max = samples.back();
+  d.p50 = samples[std::min(n - 1, static_cast<size_t>(0.50 * n))];
+  d.p90 = samples[std::min(n - 1, static_cast<size_t>(0.90 * n))];
+  d.p99 = samples[std::min(n - 1, static_cast<size_t>(0.99 * n))];
+  return d;
+}
+
+/** \brief Plan grasps for one object, run on the thread pool. */
+void planObject(size_t index,
+                ShapeGraspPlanner& planner,
+                const std::vector<grasping_msgs::Object>& objects,
+                std::vector<std::vector<moveit_msgs::Grasp> >& grasps)
+{
+  planner.plan(objects[index], grasps[index]);
+}
+
+/** \brief Run one cloud through the pipeline, as the node would. */
+Result run(const std::string& file,
+           const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+           const Eigen::Affine3f& transform,
+           bool organized,
+           const boost::shared_ptr<ubr1_grasping::ThreadPool>& pool,
+           ShapeGraspPlanner& planner,
+           int iterations)
+{
+  ObjectSupportSegmentation segmentation(0.01, 50, organized, pool);
+  segmentation.setInputVoxelized(!organized);
+
+  pcl::PassThrough<pcl::PointXYZRGB> range_filter;
+  range_filter.setFilterFieldName("z");
+  range_filter.setFilterLimits(0, 2.5);
+  range_filter.setKeepOrganized(true);
+
+  Result result;
+  result.file = file;
+  result.pipeline = organized ? "organized" : "unorganized";
+  result.points = cloud->points.size();
+
+  std::vector<double> samples[NUM_STEPS];
+  for (int i = 0; i < iterations; ++i)
+  {
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_transformed(new pcl::PointCloud<pcl::PointXYZRGB>);
+    ros::WallTime start = ros::WallTime::now();
+    if (organized)
+    {
+      pcl::PointCloud<pcl::PointXYZRGB> cloud_filtered;
+      range_filter.setInputCloud(cloud);
+      range_filter.filter(cloud_filtered);
+      pcl::transformPointCloud(cloud_filtered, *cloud_transformed, transform);
+    }
+    else
+    {
+      float min_z, max_z;
+      segmentation.getHeightLimits(min_z, max_z);
+      ubr1_grasping::rangeTransformVoxelize(*cloud, transform, 0, 2.5, min_z, max_z,
+                                            segmentation.getLeafSize(), *cloud_transformed);
+    }
+    cloud_transformed->header = cloud->header;
+    cloud_transformed->header.frame_id = "base_link";
+    samples[STEP_FILTER].push_back(elapsedMs(start));
+
+    std::vector<grasping_msgs::Object> objects;
+    std::vector<grasping_msgs::Object> supports;
+    pcl::PointCloud<pcl::PointXYZRGB> object_cloud;
+    pcl::PointCloud<pcl::PointXYZRGB> support_cloud;
+    ubr1_grasping::StageTimes times;
+    ros::WallTime segment_start = ros::WallTime::now();
+    segmentation.segment(cloud_transformed, objects, supports, object_cloud, support_cloud, false, &times);
+    samples[STEP_SEGMENT].push_back(elapsedMs(segment_start));
+    for (int j = 0; j < 4; ++j)
+    {
+      if (times.ms[SEGMENT_STEPS[j][1]] >= 0.0)
+        samples[SEGMENT_STEPS[j][0]].push_back(times.ms[SEGMENT_STEPS[j][1]]);
+    }
+
+    ros::WallTime plan_start = ros::WallTime::now();
+    std::vector<std::vector<moveit_msgs::Grasp> > grasps(objects.size());
+    pool->run(objects.size(), boost::bind(&planObject, _1, boost::ref(planner),
+                                          boost::cref(objects), boost::ref(grasps)));
+    result.grasps = 0;
+    for (size_t j = 0; j < grasps.size(); ++j)
+      result.grasps += grasps[j].size();
+    samples[STEP_PLAN].push_back(elapsedMs(plan_start));
+    samples[STEP_TOTAL].push_back(elapsedMs(start));
+
+    result.objects = objects.size();
+    result.supports = supports.size();
+  }
+
+  for (int s = 0; s < NUM_STEPS; ++s)
+  {
+    result.ran[s] = !samples[s].empty();
+    if (result.ran[s])
+      result.steps[s] = summarize(samples[s]);
+  }
+  result.peak_rss_kb = peakMemory();
+  return result;
+}
+
+/** \brief Escape a string for JSON, file names are the only free text. */
+std::string jsonString(const std::string& s)
+{
+  std::string out = "\"";
+  for (size_t i = 0; i < s.size(); ++i)
+  {
+    if (s[i] == '"' || s[i] == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(s[i]) >= 0x20)
+      out += s[i];
+  }
+  return out + "\"";
+}
+
+bool writeJson(const std::string& filename,
+               const std::vector<Result>& results,
+               int iterations,
+               unsigned int threads)
+{
+  FILE* f = fopen(filename.c_str(), "w");
+  if (!f)
+    return false;
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"iterations\": %d,\n", iterations);
+  fprintf(f, "  \"threads\": %u,\n", threads);
+  fprintf(f, "  \"peak_rss_kb\": %ld,\n", peakMemory());
+  fprintf(f, "  \"results\": [");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result& r = results[i];
+    fprintf(f, "%s\n    {\n", (i > 0) ? "," : "");
+    fprintf(f, "      \"file\": %s,\n", jsonString(r.file).c_str());
+    fprintf(f, "      \"pipeline\": \"%s\",\n", r.pipeline.c_str());
+    fprintf(f, "      \"points\": %lu,\n", static_cast<unsigned long>(r.points));
+    fprintf(f, "      \"objects\": %lu,\n", static_cast<unsigned long>(r.objects));
+    fprintf(f, "      \"supports\": %lu,\n", static_cast<unsigned long>(r.supports));
+    fprintf(f, "      \"grasps\": %lu,\n", static_cast<unsigned long>(r.grasps));
+    fprintf(f, "      \"peak_rss_kb\": %ld,\n", r.peak_rss_kb);
+    fprintf(f, "      \"latency_ms\": {");
+    bool first = true;
+    for (int s = 0; s < NUM_STEPS; ++s)
+    {
+      if (!r.ran[s])
+        continue;
+      const Distribution& d = r.steps[s];
+      fprintf(f, "%s\n        \"%s\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, "
+              "\"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+              first ? "" : ",", STEP_NAMES[s], d.mean, d.min, d.p50, d.p90, d.p99, d.max);
+      first = false;
+    }
+    fprintf(f, "\n      }\n    }");
+  }
+  fprintf(f, "\n  ]\n}\n");
+  return fclose(f) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+  // segmentation stamps its results, but no master is needed
+  ros::Time::init();
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+    ros::console::notifyLoggerLevelsChanged();
+
+  int iterations = 20;
+  int threads = 0;
+  std::string json_file;
+  Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      iterations = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      threads = std::max(0, atoi(argv[++i]));
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      json_file = argv[++i];
+    else if (strcmp(argv[i], "-t") == 0 && i + 6 < argc)
+    {
+      float v[6];
+      for (int j = 0; j < 6; ++j)
+        v[j] = atof(argv[++i]);
+      transform = Eigen::Translation3f(v[0], v[1], v[2]) *
+                  Eigen::AngleAxisf(v[5], Eigen::Vector3f::UnitZ()) *
+                  Eigen::AngleAxisf(v[4], Eigen::Vector3f::UnitY()) *
+                  Eigen::AngleAxisf(v[3], Eigen::Vector3f::UnitX());
+    }
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (files.empty())
+  {
+    fprintf(stderr, "Usage: %s [-n iterations] [-j threads] [-o results.json] "
+            "[-t x y z roll pitch yaw] cloud.pcd [cloud.pcd ...]\n", argv[0]);
+    return 1;
+  }
+
+  ShapeGraspPlanner planner(0.09, 0.02);
+  boost::shared_ptr<ubr1_grasping::ThreadPool> pool(new ubr1_grasping::ThreadPool(threads));
+
+  std::vector<Result> results;
+  for (size_t f = 0; f < files.size(); ++f)
+  {
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+    if (pcl::io::loadPCDFile(files[f], *cloud) < 0)
+    {
+      fprintf(stderr, "Unable to load %s\n", files[f].c_str());
+      continue;
+    }
+
+    results.push_back(run(files[f], cloud, transform, false, pool, planner, iterations));
+    if (cloud->isOrganized())
+      results.push_back(run(files[f], cloud, transform, true, pool, planner, iterations));
+  }
+
+  printf("%-32s %-11s %8s %4s %5s  %-10s %9s %9s %9s %9s\n",
+         "cloud", "pipeline", "points", "obj", "grasp", "stage", "p50 (ms)", "p90", "p99", "max");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const Result& r = results[i];
+    for (int s = 0; s < NUM_STEPS; ++s)
+    {
+      if (!r.ran[s])
+        continue;
+      const Distribution& d = r.steps[s];
+      if (s == 0)
+        printf("%-32s %-11s %8d %4d %5d  ", r.file.c_str(), r.pipeline.c_str(),
+               static_cast<int>(r.points), static_cast<int>(r.objects), static_cast<int>(r.grasps));
+      else
+        printf("%-32s %-11s %8s %4s %5s  ", "", "", "", "", "");
+      printf("%-10s %9.2f %9.2f %9.2f %9.2f\n", STEP_NAMES[s], d.p50, d.p90, d.p99, d.max);
+    }
+  }
+  printf("Peak memory: %ld kB\n", peakMemory());
+
+  if (!json_file.empty() && !writeJson(json_file, results, iterations, pool->size()))
+  {
+    fprintf(stderr, "Unable to write %s\n", json_file.c_str());
+    return 1;
+  }
+  return 0;
+}
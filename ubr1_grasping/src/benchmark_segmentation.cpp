@@ -0,0 +1,253 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * Copyright 2013, Michael E. Ferguson
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * The names of the authors may not be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+/*
+ * Time the unorganized (voxel grid + RANSAC) and organized (integral image
+ * normals + multi-plane segmentation) pipelines on recorded clouds, and the
+ * parallel plane fit against pcl::SACSegmentation on the voxelized cloud.
+ * Voxel clustering is checked against pcl::EuclideanClusterExtraction, it
+ * must produce exactly the same clusters.
+ *
+ * Usage: benchmark_segmentation [-n iterations] cloud.pcd [cloud.pcd ...]
+ *
+ * Clouds should be organized and already transformed into a frame where the
+ * XY plane is horizontal, as they would be by basic_grasping_perception.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <ubr1_grasping/object_support_segmentation.h>
+#include <ubr1_grasping/parallel_plane_ransac.h>
+#include <ubr1_grasping/voxel_clustering.h>
+
+using ubr1_grasping::ObjectSupportSegmentation;
+using ubr1_grasping::ParallelPlaneRansac;
+using ubr1_grasping::VoxelClustering;
+
+/** \brief Average time in ms to fit the largest plane, and its inlier count. */
+template <typename Segmenter>
+double timePlaneFit(Segmenter& segmenter,
+                    const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+                    int iterations,
+                    size_t& num_inliers)
+{
+  double total = 0.0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    pcl::PointIndices inliers;
+    pcl::ModelCoefficients coefficients;
+
+    ros::WallTime start = ros::WallTime::now();
+    segmenter.setInputCloud(cloud);
+    segmenter.segment(inliers, coefficients);
+    total += (ros::WallTime::now() - start).toSec();
+
+    num_inliers = inliers.indices.size();
+  }
+  return 1000.0 * total / iterations;
+}
+
+/** \brief Average time in ms of one segmentation, and the result sizes. */
+double timeSegmentation(ObjectSupportSegmentation& segmentation,
+                        const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+                        int iterations,
+                        size_t& num_objects,
+                        size_t& num_supports)
+{
+  double total = 0.0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    std::vector<grasping_msgs::Object> objects;
+    std::vector<grasping_msgs::Object> supports;
+    pcl::PointCloud<pcl::PointXYZRGB> object_cloud;
+    pcl::PointCloud<pcl::PointXYZRGB> support_cloud;
+
+    ros::WallTime start = ros::WallTime::now();
+    segmentation.segment(cloud, objects, supports, object_cloud, support_cloud, false);
+    total += (ros::WallTime::now() - start).toSec();
+
+    num_objects = objects.size();
+    num_supports = supports.size();
+  }
+  return 1000.0 * total / iterations;
+}
+
+/** \brief Average time in ms to cluster a cloud. */
+template <typename Clustering>
+double timeClustering(Clustering& clustering,
+                      const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+                      int iterations,
+                      std::vector<pcl::PointIndices>& clusters)
+{
+  double total = 0.0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    clusters.clear();
+
+    ros::WallTime start = ros::WallTime::now();
+    clustering.setInputCloud(cloud);
+    clustering.extract(clusters);
+    total += (ros::WallTime::now() - start).toSec();
+  }
+  return 1000.0 * total / iterations;
+}
+
+/** \brief Whether two clusterings partition the points the same way. */
+bool sameClusters(std::vector<pcl::PointIndices> a, std::vector<pcl::PointIndices> b)
+{
+  if (a.size() != b.size())
+    return false;
+  std::vector<std::vector<int> > sorted_a, sorted_b;
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    std::sort(a[i].indices.begin(), a[i].indices.end());
+    std::sort(b[i].indices.begin(), b[i].indices.end());
+    sorted_a.push_back(a[i].indices);
+    sorted_b.push_back(b[i].indices);
+  }
+  std::sort(sorted_a.begin(), sorted_a.end());
+  std::sort(sorted_b.begin(), sorted_b.end());
+  return sorted_a == sorted_b;
+}
+
+int main(int argc, char* argv[])
+{
+  // segmentation stamps its results, but no master is needed
+  ros::Time::init();
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+    ros::console::notifyLoggerLevelsChanged();
+
+  int iterations = 10;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      iterations = std::max(1, atoi(argv[++i]));
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (files.empty())
+  {
+    fprintf(stderr, "Usage: %s [-n iterations] cloud.pcd [cloud.pcd ...]\n", argv[0]);
+    return 1;
+  }
+
+  ObjectSupportSegmentation ransac(0.01, 50, false);
+  ObjectSupportSegmentation organized(0.01, 50, true);
+
+  // plane fits use the same settings as ObjectSupportSegmentation
+  pcl::VoxelGrid<pcl::PointXYZRGB> voxel_grid;
+  voxel_grid.setLeafSize(0.005f, 0.005f, 0.005f);
+  voxel_grid.setFilterFieldName("z");
+  voxel_grid.setFilterLimits(0, 1.8);
+
+  pcl::SACSegmentation<pcl::PointXYZRGB> sac;
+  sac.setOptimizeCoefficients(true);
+  sac.setModelType(pcl::SACMODEL_PLANE);
+  sac.setMaxIterations(100);
+  sac.setDistanceThreshold(0.01);
+
+  ParallelPlaneRansac parallel;
+  parallel.setOptimizeCoefficients(true);
+  parallel.setMaxIterations(100);
+  parallel.setDistanceThreshold(0.01);
+
+  pcl::EuclideanClusterExtraction<pcl::PointXYZRGB> kdtree_clustering;
+  kdtree_clustering.setClusterTolerance(0.01);
+  kdtree_clustering.setMinClusterSize(50);
+
+  VoxelClustering voxel_clustering;
+  voxel_clustering.setClusterTolerance(0.01);
+  voxel_clustering.setMinClusterSize(50);
+
+  bool all_clusters_match = true;
+
+  printf("%-32s %8s %12s %12s %8s\n", "cloud", "points", "ransac (ms)", "organized", "speedup");
+  for (size_t f = 0; f < files.size(); ++f)
+  {
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+    if (pcl::io::loadPCDFile(files[f], *cloud) < 0)
+    {
+      fprintf(stderr, "Unable to load %s\n", files[f].c_str());
+      continue;
+    }
+    if (!cloud->isOrganized())
+      fprintf(stderr, "%s is not organized, both pipelines will use RANSAC\n", files[f].c_str());
+
+    size_t ransac_objects, ransac_supports, organized_objects, organized_supports;
+    double ransac_ms = timeSegmentation(ransac, cloud, iterations, ransac_objects, ransac_supports);
+    double organized_ms = timeSegmentation(organized, cloud, iterations, organized_objects, organized_supports);
+
+    printf("%-32s %8d %12.2f %12.2f %7.2fx\n", files[f].c_str(), static_cast<int>(cloud->points.size()),
+           ransac_ms, organized_ms, ransac_ms / organized_ms);
+    printf("%-32s %8s %5d obj %2d sup %5d obj %2d sup\n", "", "",
+           static_cast<int>(ransac_objects), static_cast<int>(ransac_supports),
+           static_cast<int>(organized_objects), static_cast<int>(organized_supports));
+
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr voxelized(new pcl::PointCloud<pcl::PointXYZRGB>);
+    voxel_grid.setInputCloud(cloud);
+    voxel_grid.filter(*voxelized);
+
+    size_t sac_inliers, parallel_inliers;
+    double sac_ms = timePlaneFit(sac, voxelized, iterations, sac_inliers);
+    double parallel_ms = timePlaneFit(parallel, voxelized, iterations, parallel_inliers);
+    printf("%-32s %8d %9.2f ms %9.2f ms %7.2fx  (plane fit, %d vs %d inliers)\n", "",
+           static_cast<int>(voxelized->points.size()), sac_ms, parallel_ms, sac_ms / parallel_ms,
+           static_cast<int>(sac_inliers), static_cast<int>(parallel_inliers));
+
+    std::vector<pcl::PointIndices> kdtree_clusters, voxel_clusters;
+    double kdtree_ms = timeClustering(kdtree_clustering, voxelized, iterations, kdtree_clusters);
+    double voxel_ms = timeClustering(voxel_clustering, voxelized, iterations, voxel_clusters);
+    bool match = sameClusters(kdtree_clusters, voxel_clusters);
+    all_clusters_match = all_clusters_match && match;
+    printf("%-32s %8s %9.2f ms %9.2f ms %7.2fx  (clustering, %d clusters, %s)\n", "", "",
+           kdtree_ms, voxel_ms, kdtree_ms / voxel_ms, static_cast<int>(kdtree_clusters.size()),
+           match ? "match" : "MISMATCH");
+  }
+
+  if (!all_clusters_match)
+  {
+    fprintf(stderr, "Voxel clustering does not match pcl::EuclideanClusterExtraction\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * Copyright 2013, Michael E. Ferguson
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * The names of the authors may not be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL AUTHORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+/*
+ * Time the steps of extractShape on synthetic clusters with large hulls,
+ * such as round bowls seen at close range: the cylinder fit, and the
+ * convex hull computed for every object.
+ *
+ * Usage: benchmark_shape_extraction [-n iterations]
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <ros/time.h>
+#include <pcl/surface/convex_hull.h>
+#include <ubr1_grasping/shape_extraction.h>
+
+/**
+ *  \brief The cylinder fit extractShape used before minimumEnclosingCircle,
+ *         trying the midpoint of every pair of hull points as the center.
+ */
+void pairwiseCircle(const std::vector<Eigen::Vector2f>& hull, Eigen::Vector2f& center, float& radius)
+{
+  radius = 1000.0;
+  for (size_t i = 0; i < hull.size(); ++i)
+  {
+    for (size_t j = i + 1; j < hull.size(); ++j)
+    {
+      Eigen::Vector2f p = (hull[i] + hull[j]) / 2.0;
+      float r = 0.0;
+      for (size_t k = 0; k < hull.size(); ++k)
+        r = std::max(r, (hull[k] - p).norm());
+      if (r < radius)
+      {
+        radius = r;
+        center = p;
+      }
+    }
+  }
+}
+
+/** \brief Points on the rim of a slightly elliptical bowl, as a hull would see them. */
+std::vector<Eigen::Vector2f> bowlRim(size_t size)
+{
+  std::vector<Eigen::Vector2f> rim(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    double angle = 2.0 * M_PI * i / size;
+    rim[i] = Eigen::Vector2f(0.6 + 0.08 * cos(angle), 0.1 + 0.075 * sin(angle));
+  }
+  return rim;
+}
+
+/** \brief A filled bowl of points, projected onto the table. */
+std::vector<Eigen::Vector2f> bowlCluster(size_t size)
+{
+  std::vector<Eigen::Vector2f> cluster(size);
+  srand(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    double angle = 2.0 * M_PI * rand() / RAND_MAX;
+    double r = sqrt(static_cast<double>(rand()) / RAND_MAX);
+    cluster[i] = Eigen::Vector2f(0.6 + 0.08 * r * cos(angle), 0.1 + 0.075 * r * sin(angle));
+  }
+  return cluster;
+}
+
+int main(int argc, char* argv[])
+{
+  ros::Time::init();
+
+  int iterations = 10;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      iterations = std::max(1, atoi(argv[++i]));
+  }
+
+  printf("Cylinder fit\n");
+  printf("%8s %14s %14s %10s %10s\n", "hull", "pairwise (ms)", "welzl (ms)", "speedup", "radius");
+  size_t sizes[] = {16, 64, 128, 256, 512};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+  {
+    std::vector<Eigen::Vector2f> rim = bowlRim(sizes[s]);
+    Eigen::Vector2f center;
+    float pairwise_radius = 0.0, welzl_radius = 0.0;
+
+    ros::WallTime start = ros::WallTime::now();
+    for (int i = 0; i < iterations; ++i)
+      pairwiseCircle(rim, center, pairwise_radius);
+    double pairwise_ms = 1000.0 * (ros::WallTime::now() - start).toSec() / iterations;
+
+    start = ros::WallTime::now();
+    for (int i = 0; i < iterations; ++i)
+      ubr1_grasping::minimumEnclosingCircle(rim, center, welzl_radius);
+    double welzl_ms = 1000.0 * (ros::WallTime::now() - start).toSec() / iterations;
+
+    printf("%8d %14.3f %14.3f %9.1fx %4.4f/%4.4f\n", static_cast<int>(sizes[s]),
+           pairwise_ms, welzl_ms, pairwise_ms / welzl_ms, pairwise_radius, welzl_radius);
+  }
+
+  // Per object hull, the way extractShape used to call qhull and the way
+  //  it now reuses buffers across objects
+  printf("\nConvex hull, per object\n");
+  printf("%8s %14s %14s %10s %10s\n", "points", "qhull (ms)", "chain (ms)", "speedup", "vertices");
+  size_t cluster_sizes[] = {200, 1000, 5000, 20000};
+  ubr1_grasping::ShapeExtractionBuffers buffers;
+  for (size_t s = 0; s < sizeof(cluster_sizes) / sizeof(cluster_sizes[0]); ++s)
+  {
+    std::vector<Eigen::Vector2f> cluster = bowlCluster(cluster_sizes[s]);
+    size_t qhull_vertices = 0;
+
+    ros::WallTime start = ros::WallTime::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+      pcl::PointCloud<pcl::PointXYZRGB>::Ptr flat(new pcl::PointCloud<pcl::PointXYZRGB>);
+      for (size_t j = 0; j < cluster.size(); ++j)
+      {
+        pcl::PointXYZRGB p;
+        p.x = cluster[j](0);
+        p.y = cluster[j](1);
+        p.z = 0.0;
+        flat->push_back(p);
+      }
+      pcl::PointCloud<pcl::PointXYZRGB> hull;
+      pcl::ConvexHull<pcl::PointXYZRGB> convex_hull;
+      convex_hull.setInputCloud(flat);
+      convex_hull.setDimension(2);
+      convex_hull.reconstruct(hull);
+      qhull_vertices = hull.size();
+    }
+    double qhull_ms = 1000.0 * (ros::WallTime::now() - start).toSec() / iterations;
+
+    start = ros::WallTime::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+      buffers.points.assign(cluster.begin(), cluster.end());
+      ubr1_grasping::convexHull2D(buffers.points, buffers.hull);
+    }
+    double chain_ms = 1000.0 * (ros::WallTime::now() - start).toSec() / iterations;
+
+    printf("%8d %14.3f %14.3f %9.1fx %4d/%-4d\n", static_cast<int>(cluster_sizes[s]),
+           qhull_ms, chain_ms, qhull_ms / chain_ms,
+           static_cast<int>(qhull_vertices), static_cast<int>(buffers.hull.size()));
+  }
+
+  return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+/*
+ * Build the reachability map of the UBR1 arm offline. Random arm
+ * configurations within the joint limits are run through forward
+ * kinematics, marking the voxel and approach direction of the wrist. The
+ * map is in torso_lift_link, so it holds at any torso height, and the
+ * torso lift is recorded so poses in base_link can be queried too.
+ *
+ * Usage: build_reachability_map [-n samples] [-r resolution] robot.urdf output.map
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl_parser/kdl_parser.hpp>
+#include <ros/time.h>
+#include <urdf/model.h>
+#include <ubr1_grasping/reachability_map.h>
+
+const std::string BASE_LINK = "base_link";
+const std::string ROOT_LINK = "torso_lift_link";
+const std::string TIP_LINK = "wrist_roll_link";
+
+/**
+ *  \brief Get the joint limits of a chain, continuous joints get one revolution.
+ */
+void getLimits(const urdf::Model& model, const KDL::Chain& chain,
+               KDL::JntArray& q_min, KDL::JntArray& q_max)
+{
+  q_min.resize(chain.getNrOfJoints());
+  q_max.resize(chain.getNrOfJoints());
+  size_t j = 0;
+  for (size_t i = 0; i < chain.getNrOfSegments(); ++i)
+  {
+    const KDL::Joint& joint = chain.getSegment(i).getJoint();
+    if (joint.getType() == KDL::Joint::None)
+      continue;
+
+    boost::shared_ptr<const urdf::Joint> urdf_joint = model.getJoint(joint.getName());
+    if (!urdf_joint || urdf_joint->type == urdf::Joint::CONTINUOUS || !urdf_joint->limits)
+    {
+      q_min(j) = -M_PI;
+      q_max(j) = M_PI;
+    }
+    else
+    {
+      q_min(j) = urdf_joint->limits->lower;
+      q_max(j) = urdf_joint->limits->upper;
+    }
+    ++j;
+  }
+}
+
+/**
+ *  \brief Sample the chain, finding the bounds of the workspace when map
+ *         is NULL, otherwise filling in the map.
+ */
+void sample(const KDL::Chain& chain, const KDL::JntArray& q_min, const KDL::JntArray& q_max,
+            int samples, Eigen::Vector3f& min_p, Eigen::Vector3f& max_p,
+            ubr1_grasping::ReachabilityMap* map)
+{
+  // Same seed every time, so both passes see the same configurations
+  boost::mt19937 rng(42);
+  boost::uniform_real<double> dist(0.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > random(rng, dist);
+
+  KDL::ChainFkSolverPos_recursive fk(chain);
+  KDL::JntArray q(chain.getNrOfJoints());
+  KDL::Frame frame;
+  for (int i = 0; i < samples; ++i)
+  {
+    for (unsigned int j = 0; j < q.rows(); ++j)
+      q(j) = q_min(j) + random() * (q_max(j) - q_min(j));
+    fk.JntToCart(q, frame);
+
+    Eigen::Vector3f p(frame.p.x(), frame.p.y(), frame.p.z());
+    if (map)
+    {
+      KDL::Vector x = frame.M.UnitX();
+      map->add(p, Eigen::Vector3f(x.x(), x.y(), x.z()));
+    }
+    else
+    {
+      min_p = min_p.cwiseMin(p);
+      max_p = max_p.cwiseMax(p);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int samples = 10000000;
+  double resolution = 0.05;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      samples = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      resolution = atof(argv[++i]);
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (files.size() != 2 || resolution <= 0.0)
+  {
+    fprintf(stderr, "Usage: %s [-n samples] [-r resolution] robot.urdf output.map\n", argv[0]);
+    return 1;
+  }
+
+  urdf::Model model;
+  KDL::Tree tree;
+  if (!model.initFile(files[0]) || !kdl_parser::treeFromUrdfModel(model, tree))
+  {
+    fprintf(stderr, "Could not load %s\n", files[0].c_str());
+    return 1;
+  }
+
+  KDL::Chain arm, lift;
+  if (!tree.getChain(ROOT_LINK, TIP_LINK, arm) || !tree.getChain(BASE_LINK, ROOT_LINK, lift) ||
+      lift.getNrOfJoints() != 1)
+  {
+    fprintf(stderr, "Could not find the arm and torso lift chains\n");
+    return 1;
+  }
+
+  KDL::JntArray q_min, q_max;
+  getLimits(model, arm, q_min, q_max);
+
+  ros::Time::init();
+  ros::WallTime start = ros::WallTime::now();
+
+  // First pass finds the bounds, padded so edge voxels are whole
+  Eigen::Vector3f min_p = Eigen::Vector3f::Constant(1e6);
+  Eigen::Vector3f max_p = Eigen::Vector3f::Constant(-1e6);
+  sample(arm, q_min, q_max, samples, min_p, max_p, NULL);
+  min_p -= Eigen::Vector3f::Constant(resolution);
+  max_p += Eigen::Vector3f::Constant(resolution);
+
+  ubr1_grasping::ReachabilityMap map;
+  map.create(ROOT_LINK, TIP_LINK, min_p, max_p, resolution);
+  sample(arm, q_min, q_max, samples, min_p, max_p, &map);
+
+  // The lift moves the root of the arm along an axis
+  KDL::JntArray lift_min, lift_max;
+  getLimits(model, lift, lift_min, lift_max);
+  KDL::ChainFkSolverPos_recursive lift_fk(lift);
+  KDL::JntArray q(1);
+  KDL::Frame zero, one;
+  q(0) = 0.0;
+  lift_fk.JntToCart(q, zero);
+  q(0) = 1.0;
+  lift_fk.JntToCart(q, one);
+  KDL::Vector axis = one.p - zero.p;
+  double roll, pitch, yaw;
+  zero.M.GetRPY(roll, pitch, yaw);
+  if (fabs(roll) > 1e-3 || fabs(pitch) > 1e-3 || fabs(yaw) > 1e-3)
+    fprintf(stderr, "Warning: %s is rotated from %s, base queries will be wrong\n",
+            ROOT_LINK.c_str(), BASE_LINK.c_str());
+  map.setLift(BASE_LINK,
+              Eigen::Vector3f(zero.p.x(), zero.p.y(), zero.p.z()),
+              Eigen::Vector3f(axis.x(), axis.y(), axis.z()),
+              lift_min(0), lift_max(0));
+
+  const ubr1_grasping::ReachabilityMapHeader* h = map.getHeader();
+  printf("Sampled %d configurations in %.1f seconds\n", samples, (ros::WallTime::now() - start).toSec());
+  printf("Map is %u x %u x %u voxels of %.3f m, %lu reachable\n",
+         h->size_x, h->size_y, h->size_z, h->resolution,
+         static_cast<unsigned long>(map.getReachableCount()));
+
+  if (!map.save(files[1]))
+  {
+    fprintf(stderr, "Could not write %s\n", files[1].c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -30,6 +30,8 @@
 
 // Author: Michael Ferguson
 
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
 #include <ubr1_grasping/cloud_tools.h>
 
 namespace ubr1_grasping
@@ -98,4 +100,89 @@ double distancePointToPlane(const Eigen::Vector4f& point, const pcl::ModelCoeffi
   return pp.dot(m);
 }
 
+namespace
+{
+
+// Running sums for one voxel
+struct VoxelAccumulator
+{
+  Eigen::Vector4f xyz;  // w unused, keeps the sum aligned for SSE
+  float r, g, b;
+  int count;
+};
+
+}  // namespace
+
+void rangeTransformVoxelize(const pcl::PointCloud<pcl::PointXYZRGB>& input,
+                            const Eigen::Affine3f& transform,
+                            float min_range, float max_range,
+                            float min_z, float max_z,
+                            float leaf_size,
+                            pcl::PointCloud<pcl::PointXYZRGB>& output)
+{
+  // Index into voxels, the map only holds offsets so that buckets stay small
+  const float inverse_leaf = 1.0f / leaf_size;
+  boost::unordered_map<boost::uint64_t, size_t> voxel_map;
+  std::vector<VoxelAccumulator, Eigen::aligned_allocator<VoxelAccumulator> > voxels;
+  voxel_map.rehash(input.points.size() / 8);
+  voxels.reserve(input.points.size() / 8);
+
+  const Eigen::Matrix4f m = transform.matrix();
+  for (size_t i = 0; i < input.points.size(); ++i)
+  {
+    const pcl::PointXYZRGB& p = input.points[i];
+
+    // Range filter in the sensor frame, also removes NaN
+    if (!(p.z >= min_range && p.z <= max_range))
+      continue;
+
+    // Transform, as a 4x4 product so Eigen can use SIMD
+    Eigen::Vector4f q = m * Eigen::Vector4f(p.x, p.y, p.z, 1.0f);
+    if (!(q[2] >= min_z && q[2] <= max_z) || !pcl_isfinite(q[0]) || !pcl_isfinite(q[1]))
+      continue;
+
+    // Hash into a voxel, 21 bits per axis covers +/-5km at 5mm
+    boost::uint64_t ix = static_cast<boost::uint64_t>(static_cast<boost::int64_t>(floor(q[0] * inverse_leaf)) + (1 << 20)) & 0x1fffff;
+    boost::uint64_t iy = static_cast<boost::uint64_t>(static_cast<boost::int64_t>(floor(q[1] * inverse_leaf)) + (1 << 20)) & 0x1fffff;
+    boost::uint64_t iz = static_cast<boost::uint64_t>(static_cast<boost::int64_t>(floor(q[2] * inverse_leaf)) + (1 << 20)) & 0x1fffff;
+    boost::uint64_t key = (ix << 42) | (iy << 21) | iz;
+
+    std::pair<boost::unordered_map<boost::uint64_t, size_t>::iterator, bool> inserted =
+      voxel_map.insert(std::make_pair(key, voxels.size()));
+    if (inserted.second)
+    {
+      VoxelAccumulator v;
+      v.xyz.setZero();
+      v.r = v.g = v.b = 0.0f;
+      v.count = 0;
+      voxels.push_back(v);
+    }
+
+    VoxelAccumulator& v = voxels[inserted.first->second];
+    v.xyz += q;
+    v.r += p.r;
+    v.g += p.g;
+    v.b += p.b;
+    ++v.count;
+  }
+
+  // Output centroids
+  output.points.resize(voxels.size());
+  for (size_t i = 0; i < voxels.size(); ++i)
+  {
+    const VoxelAccumulator& v = voxels[i];
+    const float scale = 1.0f / v.count;
+    pcl::PointXYZRGB& p = output.points[i];
+    p.x = v.xyz[0] * scale;
+    p.y = v.xyz[1] * scale;
+    p.z = v.xyz[2] * scale;
+    p.r = static_cast<uint8_t>(v.r * scale);
+    p.g = static_cast<uint8_t>(v.g * scale);
+    p.b = static_cast<uint8_t>(v.b * scale);
+  }
+  output.width = output.points.size();
+  output.height = 1;
+  output.is_dense = true;
+}
+
 }  // namespace ubr1_grasping
@@ -0,0 +1,386 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <ros/ros.h>
+#include <kdl_parser/kdl_parser.hpp>
+#include <ubr1_grasping/grasp_reachability_filter.h>
+
+namespace ubr1_grasping
+{
+
+// Iterations and tolerance of the IK check, the seed is usually close
+const int IK_MAX_ITERATIONS = 50;
+const double IK_EPSILON = 1e-4;
+
+// Fixed seed, so the map is the same every time
+const unsigned int MAP_SEED = 42;
+
+// Random configurations tried when the seeds from the map fail, in
+//  addition to the middle of the joint limits
+const int RANDOM_FALLBACK_SEEDS = 3;
+
+// With a map built offline, a smaller sampled map is still kept, only
+//  as a table of IK seeds
+const int SEED_TABLE_SAMPLES = 20000;
+
+bool compareGraspQuality(const moveit_msgs::Grasp& a, const moveit_msgs::Grasp& b)
+{
+  return a.grasp_quality > b.grasp_quality;
+}
+
+GraspReachabilityFilter::GraspReachabilityFilter(double resolution,
+                                                 int samples,
+                                                 const boost::shared_ptr<ThreadPool>& thread_pool) :
+  resolution_(resolution),
+  samples_(samples),
+  size_x_(0),
+  size_y_(0),
+  size_z_(0),
+  use_map_(false),
+  pool_(thread_pool ? thread_pool : boost::shared_ptr<ThreadPool>(new ThreadPool()))
+{
+}
+
+bool GraspReachabilityFilter::init(const urdf::Model& model,
+                                   const std::string& root_link,
+                                   const std::string& tip_link,
+                                   const std::string& map_file)
+{
+  root_link_ = root_link;
+  tip_link_ = tip_link;
+
+  KDL::Tree tree;
+  if (!kdl_parser::treeFromUrdfModel(model, tree))
+  {
+    ROS_ERROR("Could not construct tree from URDF");
+    return false;
+  }
+
+  if (!tree.getChain(root_link, tip_link, chain_))
+  {
+    ROS_ERROR("Could not construct chain from %s to %s", root_link.c_str(), tip_link.c_str());
+    return false;
+  }
+
+  // Joint limits, continuous joints get one revolution
+  q_min_.resize(chain_.getNrOfJoints());
+  q_max_.resize(chain_.getNrOfJoints());
+  size_t j = 0;
+  for (size_t i = 0; i < chain_.getNrOfSegments(); ++i)
+  {
+    const KDL::Joint& joint = chain_.getSegment(i).getJoint();
+    if (joint.getType() == KDL::Joint::None)
+      continue;
+
+    boost::shared_ptr<const urdf::Joint> urdf_joint = model.getJoint(joint.getName());
+    if (!urdf_joint || urdf_joint->type == urdf::Joint::CONTINUOUS || !urdf_joint->limits)
+    {
+      q_min_(j) = -M_PI;
+      q_max_(j) = M_PI;
+    }
+    else
+    {
+      q_min_(j) = urdf_joint->limits->lower;
+      q_max_(j) = urdf_joint->limits->upper;
+    }
+    ++j;
+  }
+
+  // Solvers for each worker, KDL solvers are not thread safe
+  solvers_.resize(pool_->size());
+  for (size_t i = 0; i < solvers_.size(); ++i)
+  {
+    Solvers& s = solvers_[i];
+    s.fk.reset(new KDL::ChainFkSolverPos_recursive(chain_));
+    s.ik_vel.reset(new KDL::ChainIkSolverVel_pinv(chain_));
+    s.ik.reset(new KDL::ChainIkSolverPos_NR_JL(chain_, q_min_, q_max_, *s.fk, *s.ik_vel,
+                                               IK_MAX_ITERATIONS, IK_EPSILON));
+    s.result.resize(chain_.getNrOfJoints());
+  }
+
+  // Fixed seeds, the middle of the limits and a few random configurations
+  boost::mt19937 rng(MAP_SEED);
+  boost::uniform_real<double> dist(0.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > random(rng, dist);
+  fallback_seeds_.assign(RANDOM_FALLBACK_SEEDS + 1, KDL::JntArray(chain_.getNrOfJoints()));
+  for (size_t i = 0; i < fallback_seeds_.size(); ++i)
+  {
+    for (unsigned int j = 0; j < chain_.getNrOfJoints(); ++j)
+    {
+      double t = (i == 0) ? 0.5 : random();
+      fallback_seeds_[i](j) = q_min_(j) + t * (q_max_(j) - q_min_(j));
+    }
+  }
+
+  voxels_.clear();
+  seeds_.clear();
+  size_x_ = size_y_ = size_z_ = 0;
+  use_map_ = false;
+
+  // Sampling the full map takes a while. With a map built offline, only
+  //  a small map is sampled, for its seeds.
+  int samples = samples_;
+  if (!map_file.empty() && loadMap(map_file))
+  {
+    ROS_INFO("Using reachability map %s", map_file.c_str());
+    samples = std::min(samples_, SEED_TABLE_SAMPLES);
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  buildMap(samples);
+  ROS_INFO("Reachability map of %d voxels, %d reachable, built in %f seconds",
+           static_cast<int>(voxels_.size()), static_cast<int>(seeds_.size()),
+           (ros::WallTime::now() - start).toSec());
+
+  return true;
+}
+
+bool GraspReachabilityFilter::loadMap(const std::string& filename)
+{
+  use_map_ = false;
+  if (!map_.load(filename))
+  {
+    ROS_ERROR("Could not load reachability map %s", filename.c_str());
+    return false;
+  }
+
+  const ReachabilityMapHeader* h = map_.getHeader();
+  if (root_link_ != h->base_frame_id || tip_link_ != h->tip_frame_id)
+  {
+    ROS_ERROR("Reachability map is for %s to %s, not %s to %s", h->base_frame_id, h->tip_frame_id,
+              root_link_.c_str(), tip_link_.c_str());
+    return false;
+  }
+
+  use_map_ = true;
+  return true;
+}
+
+int GraspReachabilityFilter::filter(std::vector<moveit_msgs::Grasp>& grasps, size_t max_grasps)
+{
+  std::vector<char> keep(grasps.size(), 0);
+  pool_->run(grasps.size(),
+             boost::bind(&GraspReachabilityFilter::checkGrasp, this, _1, _2,
+                         boost::cref(grasps), boost::ref(keep)));
+
+  // Compact, keeping the planner order for grasps of equal quality
+  size_t kept = 0;
+  for (size_t i = 0; i < grasps.size(); ++i)
+  {
+    if (!keep[i])
+      continue;
+    if (kept != i)
+      grasps[kept] = grasps[i];
+    ++kept;
+  }
+  ROS_DEBUG("%d of %d grasps are reachable", static_cast<int>(kept), static_cast<int>(grasps.size()));
+  grasps.resize(kept);
+
+  std::stable_sort(grasps.begin(), grasps.end(), compareGraspQuality);
+  if (max_grasps > 0 && grasps.size() > max_grasps)
+    grasps.resize(max_grasps);
+
+  return grasps.size();
+}
+
+bool GraspReachabilityFilter::isReachable(const KDL::Frame& pose, unsigned int worker)
+{
+  // Most unreachable poses are not in the map at all. When a map built
+  //  offline is loaded, that map decides, and the sampled one (which may
+  //  miss the edges of the workspace) only provides seeds.
+  int index = voxels_.empty() ? -1 : voxelIndex(pose.p);
+  if (!use_map_ && (index < 0 || voxels_[index] < 0))
+    return false;
+
+  if (use_map_)
+  {
+    KDL::Vector x = pose.M.UnitX();
+    Eigen::Isometry3d p = Eigen::Isometry3d::Identity();
+    p.translation() = Eigen::Vector3d(pose.p.x(), pose.p.y(), pose.p.z());
+    p.linear().col(0) = Eigen::Vector3d(x.x(), x.y(), x.z());
+    if (!map_.isReachableFromBase(p))
+      return false;
+  }
+
+  // The seed of a voxel only reaches its position, with any orientation,
+  //  so retry from the neighboring voxels and the fixed seeds before rejecting
+  Solvers& s = solvers_[worker];
+  if (index >= 0)
+  {
+    int seed = voxels_[index];
+    if (seed >= 0 && solve(seeds_[seed], pose, s))
+      return true;
+
+    int stride[3] = {1, size_x_, size_x_ * size_y_};
+    for (int k = 0; k < 3; ++k)
+    {
+      for (int side = -1; side <= 1; side += 2)
+      {
+        int neighbor = index + side * stride[k];
+        if (neighbor < 0 || neighbor >= static_cast<int>(voxels_.size()) ||
+            voxels_[neighbor] < 0 || voxels_[neighbor] == seed)
+          continue;
+        if (solve(seeds_[voxels_[neighbor]], pose, s))
+          return true;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < fallback_seeds_.size(); ++i)
+  {
+    if (solve(fallback_seeds_[i], pose, s))
+      return true;
+  }
+  return false;
+}
+
+bool GraspReachabilityFilter::solve(const KDL::JntArray& seed, const KDL::Frame& pose, Solvers& s)
+{
+  return s.ik->CartToJnt(seed, pose, s.result) >= 0;
+}
+
+int GraspReachabilityFilter::voxelIndex(const KDL::Vector& p) const
+{
+  int x = static_cast<int>(std::floor((p.x() - origin_.x()) / resolution_));
+  int y = static_cast<int>(std::floor((p.y() - origin_.y()) / resolution_));
+  int z = static_cast<int>(std::floor((p.z() - origin_.z()) / resolution_));
+  if (x < 0 || y < 0 || z < 0 || x >= size_x_ || y >= size_y_ || z >= size_z_)
+    return -1;
+  return (z * size_y_ + y) * size_x_ + x;
+}
+
+void GraspReachabilityFilter::buildMap(int samples)
+{
+  unsigned int joints = chain_.getNrOfJoints();
+  KDL::ChainFkSolverPos_recursive& fk = *solvers_[0].fk;
+  KDL::JntArray q(joints);
+  KDL::Frame frame;
+
+  // Sampling is done twice with the same seed, first to find the
+  //  bounds of the workspace, then to fill in the map
+  KDL::Vector min_p(1e6, 1e6, 1e6), max_p(-1e6, -1e6, -1e6);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    boost::mt19937 rng(MAP_SEED);
+    boost::uniform_real<double> dist(0.0, 1.0);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > random(rng, dist);
+
+    for (int i = 0; i < samples; ++i)
+    {
+      for (unsigned int j = 0; j < joints; ++j)
+        q(j) = q_min_(j) + random() * (q_max_(j) - q_min_(j));
+      fk.JntToCart(q, frame);
+
+      if (pass == 0)
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          min_p(k) = std::min(min_p(k), frame.p(k));
+          max_p(k) = std::max(max_p(k), frame.p(k));
+        }
+        continue;
+      }
+
+      int index = voxelIndex(frame.p);
+      if (index >= 0 && voxels_[index] < 0)
+      {
+        voxels_[index] = seeds_.size();
+        seeds_.push_back(q);
+      }
+    }
+
+    if (pass == 0)
+    {
+      // One voxel of padding on each side, for the dilation below
+      origin_ = min_p - KDL::Vector(resolution_, resolution_, resolution_);
+      size_x_ = static_cast<int>(std::ceil((max_p.x() - min_p.x()) / resolution_)) + 3;
+      size_y_ = static_cast<int>(std::ceil((max_p.y() - min_p.y()) / resolution_)) + 3;
+      size_z_ = static_cast<int>(std::ceil((max_p.z() - min_p.z()) / resolution_)) + 3;
+      voxels_.assign(size_x_ * size_y_ * size_z_, -1);
+      seeds_.clear();
+    }
+  }
+
+  // Sampling misses voxels at the edge of the workspace, so grow the map
+  //  by one voxel. The IK check still decides if these are reachable.
+  std::vector<int> sampled(voxels_);
+  int stride[3] = {1, size_x_, size_x_ * size_y_};
+  for (int z = 1; z < size_z_ - 1; ++z)
+  {
+    for (int y = 1; y < size_y_ - 1; ++y)
+    {
+      for (int x = 1; x < size_x_ - 1; ++x)
+      {
+        int index = (z * size_y_ + y) * size_x_ + x;
+        for (int k = 0; k < 3 && voxels_[index] < 0; ++k)
+        {
+          if (sampled[index - stride[k]] >= 0)
+            voxels_[index] = sampled[index - stride[k]];
+          else if (sampled[index + stride[k]] >= 0)
+            voxels_[index] = sampled[index + stride[k]];
+        }
+      }
+    }
+  }
+}
+
+void GraspReachabilityFilter::checkGrasp(size_t index, unsigned int worker,
+                                         const std::vector<moveit_msgs::Grasp>& grasps,
+                                         std::vector<char>& keep)
+{
+  const geometry_msgs::PoseStamped& pose = grasps[index].grasp_pose;
+  if (pose.header.frame_id != root_link_)
+  {
+    ROS_WARN_ONCE("Grasps are in %s, not %s, and cannot be checked for reachability",
+                  pose.header.frame_id.c_str(), root_link_.c_str());
+    keep[index] = 1;
+    return;
+  }
+
+  KDL::Frame frame(KDL::Rotation::Quaternion(pose.pose.orientation.x,
+                                             pose.pose.orientation.y,
+                                             pose.pose.orientation.z,
+                                             pose.pose.orientation.w),
+                   KDL::Vector(pose.pose.position.x,
+                               pose.pose.position.y,
+                               pose.pose.position.z));
+  keep[index] = isReachable(frame, worker);
+}
+
+}  // namespace ubr1_grasping
@@ -28,10 +28,14 @@
 
 // Author: Michael Ferguson
 
+#include <limits>
+
 #include <Eigen/Eigen>
 #include <boost/lexical_cast.hpp>
 
 #include <ros/ros.h>
+#include <pcl/segmentation/euclidean_cluster_comparator.h>
+#include <pcl/segmentation/organized_connected_component_segmentation.h>
 #include <ubr1_grasping/cloud_tools.h>
 #include <ubr1_grasping/shape_extraction.h>
 #include <ubr1_grasping/object_support_segmentation.h>
@@ -41,8 +45,18 @@ namespace ubr1_grasping
 
 ObjectSupportSegmentation::ObjectSupportSegmentation(
   double cluster_tolerance,
-  int cluster_min_size)
+  int cluster_min_size,
+  bool use_organized,
+  const boost::shared_ptr<ThreadPool>& thread_pool) :
+    cluster_tolerance_(cluster_tolerance),
+    cluster_min_size_(cluster_min_size),
+    organized_cluster_min_size_(cluster_min_size * ORGANIZED_CLUSTER_SCALE),
+    use_organized_(use_organized),
+    input_voxelized_(false),
+    thread_pool_(thread_pool ? thread_pool : boost::shared_ptr<ThreadPool>(new ThreadPool()))
 {
+  shape_buffers_.resize(thread_pool_->size());
+
   // cluster_tolerance: minimum separation distance of two objects
   extract_clusters_.setClusterTolerance(cluster_tolerance);
 
@@ -55,9 +69,17 @@ ObjectSupportSegmentation::ObjectSupportSegmentation(
   voxel_grid_.setFilterLimits(0, 1.8);
 
   segment_.setOptimizeCoefficients(true);
-  segment_.setModelType(pcl::SACMODEL_PLANE);
   segment_.setMaxIterations(100);
   segment_.setDistanceThreshold(0.01);
+  segment_.setThreadPool(thread_pool_);
+
+  // organized pipeline: normals from integral images, then all planes at once
+  normal_estimation_.setNormalEstimationMethod(normal_estimation_.COVARIANCE_MATRIX);
+  normal_estimation_.setMaxDepthChangeFactor(0.02f);
+  normal_estimation_.setNormalSmoothingSize(10.0f);
+
+  multi_plane_segmentation_.setAngularThreshold(0.05);  // ~3 degrees
+  multi_plane_segmentation_.setDistanceThreshold(0.01);
 }
 
 bool ObjectSupportSegmentation::segment(
@@ -66,27 +88,182 @@ bool ObjectSupportSegmentation::segment(
   std::vector<grasping_msgs::Object>& supports,
   pcl::PointCloud<pcl::PointXYZRGB>& object_cloud,
   pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
-  bool output_clouds)
+  bool output_clouds,
+  StageTimes* times)
 {
   ROS_INFO("object support segmentation starting...");
 
-  // process the cloud with a voxel grid
-  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_filtered(new pcl::PointCloud<pcl::PointXYZRGB>);
-  voxel_grid_.setInputCloud(cloud);
-  voxel_grid_.filter(*cloud_filtered);
+  // Find supports, and clusters of the points which are not supports
+  std::vector<pcl::ModelCoefficients::Ptr> plane_coefficients;  // coefs of all planes found
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr object_points;
+  std::vector<pcl::PointIndices> clusters;
+  if (use_organized_ && cloud->isOrganized())
+  {
+    segmentOrganized(cloud, supports, support_cloud, output_clouds,
+                     plane_coefficients, object_points, clusters, times);
+  }
+  else
+  {
+    segmentUnorganized(cloud, supports, support_cloud, output_clouds,
+                       plane_coefficients, object_points, clusters, times);
+  }
+  ROS_DEBUG("Extracted %d clusters.", static_cast<int>(clusters.size()));
+
+  // Process clusters in parallel, results are kept in cluster order
+  std::vector<grasping_msgs::Object> cluster_objects(clusters.size());
+  std::vector<char> valid(clusters.size(), 0);
+  ScopedStageTimer shapes_timer(times, STAGE_SHAPES);
+  thread_pool_->run(clusters.size(),
+                    boost::bind(&ObjectSupportSegmentation::extractObject, this, _1, _2,
+                                 boost::cref(object_points), boost::cref(clusters),
+                                 boost::cref(plane_coefficients), boost::cref(cloud->header.frame_id),
+                                 boost::ref(cluster_objects), boost::ref(valid)));
+  shapes_timer.stop();
+
+  for (size_t i = 0; i < clusters.size(); ++i)
+  {
+    if (!valid[i])
+      continue;
+
+    // add object to object list
+    objects.push_back(grasping_msgs::Object());
+    std::swap(objects.back(), cluster_objects[i]);
+
+    if (output_clouds)
+    {
+      pcl::PointCloud<pcl::PointXYZRGB> new_cloud;
+      pcl::copyPointCloud(*object_points, clusters[i], new_cloud);
+      ROS_DEBUG("Adding an object cluster of size %d.", static_cast<int>(new_cloud.points.size()));
+      float hue = (360.0 / clusters.size()) * i;
+      colorizeCloud(new_cloud, hue);
+      object_cloud += new_cloud;
+    }
+  }
+
+  ROS_INFO("object support segmentation done processing.");
+  return true;
+}
+
+void ObjectSupportSegmentation::extractObject(
+  size_t index,
+  unsigned int worker,
+  const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+  const std::vector<pcl::PointIndices>& clusters,
+  const std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+  const std::string& frame_id,
+  std::vector<grasping_msgs::Object>& objects,
+  std::vector<char>& valid)
+{
+  // Extract object
+  pcl::PointCloud<pcl::PointXYZRGB> new_cloud;
+  pcl::copyPointCloud(*object_points, clusters[index], new_cloud);
+
+  // Find centroid
+  Eigen::Vector4f centroid;
+  pcl::compute3DCentroid(new_cloud, centroid);
+
+  // Compare centroid to planes to find which plane we are supported by
+  int support_plane_index = -1;
+  double support_plane_distance = 1000.0;
+  for (int p = 0; p < plane_coefficients.size(); ++p)
+  {
+    double distance = distancePointToPlane(centroid, plane_coefficients[p]);
+    if (distance > 0.0 && distance < support_plane_distance)
+    {
+      support_plane_distance = distance;
+      support_plane_index = p;
+    }
+  }
+
+  if (support_plane_index == -1)
+  {
+    ROS_DEBUG("No support plane found for object");
+    return;
+  }
+
+  // new object, with cluster and bounding box
+  grasping_msgs::Object& object = objects[index];
+  // set name of supporting surface
+  object.support_surface = std::string("surface") + boost::lexical_cast<std::string>(support_plane_index);
+  // add shape, pose and transformed cluster
+  shape_msgs::SolidPrimitive box;
+  geometry_msgs::Pose pose;
+  pcl::PointCloud<pcl::PointXYZRGB> projected_cloud;
+  extractShape(new_cloud, plane_coefficients[support_plane_index], projected_cloud, box, pose,
+               shape_buffers_[worker]);
+  pcl::toROSMsg(projected_cloud, object.point_cluster);
+  object.primitives.push_back(box);
+  object.primitive_poses.push_back(pose);
+  // add stamp and frame
+  object.header.stamp = ros::Time::now();
+  object.header.frame_id = frame_id;
+  valid[index] = 1;
+}
+
+void ObjectSupportSegmentation::setOrganizedClusterMinSize(int cluster_min_size)
+{
+  organized_cluster_min_size_ = cluster_min_size;
+}
+
+void ObjectSupportSegmentation::setInputVoxelized(bool voxelized)
+{
+  input_voxelized_ = voxelized;
+}
+
+float ObjectSupportSegmentation::getLeafSize() const
+{
+  return voxel_grid_.getLeafSize()[0];
+}
+
+void ObjectSupportSegmentation::getHeightLimits(float& min_z, float& max_z) const
+{
+  double min, max;
+  voxel_grid_.getFilterLimits(min, max);
+  min_z = min;
+  max_z = max;
+}
+
+void ObjectSupportSegmentation::segmentUnorganized(
+  const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+  std::vector<grasping_msgs::Object>& supports,
+  pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+  bool output_clouds,
+  std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+  std::vector<pcl::PointIndices>& clusters,
+  StageTimes* times)
+{
+  // process the cloud with a voxel grid, unless the caller already has
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr cloud_filtered = cloud;
+  if (!input_voxelized_)
+  {
+    ScopedStageTimer timer(times, STAGE_VOXELIZE);
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr voxelized(new pcl::PointCloud<pcl::PointXYZRGB>);
+    voxel_grid_.setInputCloud(cloud);
+    voxel_grid_.filter(*voxelized);
+    cloud_filtered = voxelized;
+  }
   ROS_DEBUG("Filtered for transformed Z, now %d points.", static_cast<int>(cloud_filtered->points.size()));
 
-  // remove support planes
-  pcl::PointCloud<pcl::PointXYZRGB>::Ptr non_horizontal_planes(new pcl::PointCloud<pcl::PointXYZRGB>);
-  std::vector<pcl::ModelCoefficients::Ptr> plane_coefficients;  // coefs of all planes found
+  // remove support planes, the filtered cloud is never modified, instead
+  // planes are masked out and RANSAC runs over the remaining indices
+  ScopedStageTimer planes_timer(times, STAGE_PLANES);
+  std::vector<bool> is_plane(cloud_filtered->points.size(), false);    // any plane, excluded from search
+  std::vector<bool> is_support(cloud_filtered->points.size(), false);  // horizontal planes only
+  pcl::PointIndices::Ptr remaining(new pcl::PointIndices);
+  remaining->indices.resize(cloud_filtered->points.size());
+  for (size_t i = 0; i < remaining->indices.size(); ++i)
+    remaining->indices[i] = i;
+
   int thresh = cloud_filtered->points.size()/8;
-  while (cloud_filtered->points.size() > 500)
+  segment_.setInputCloud(cloud_filtered);
+  while (remaining->indices.size() > 500)
   {
     pcl::PointIndices::Ptr inliers(new pcl::PointIndices);
     pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients);
 
-    // Segment the largest planar component from the remaining cloud
-    segment_.setInputCloud(cloud_filtered);
+    // Segment the largest planar component from the remaining points
+    segment_.setIndices(remaining);
     segment_.segment(*inliers, *coefficients);
     if (inliers->indices.size() < (size_t) thresh)  // TODO: make configurable? TODO make this based on "can we grasp object"
     {
@@ -94,134 +271,209 @@ bool ObjectSupportSegmentation::segment(
       break;
     }
 
-    // Extract planar part for message
-    pcl::PointCloud<pcl::PointXYZRGB> plane;
-    pcl::ExtractIndices<pcl::PointXYZRGB> extract;
-    extract.setInputCloud(cloud_filtered);
-    extract.setIndices(inliers);
-    extract.setNegative(false);
-    extract.filter(plane);
-
     // Check plane is mostly horizontal
     Eigen::Vector3f normal(coefficients->values[0], coefficients->values[1], coefficients->values[2]);
     float angle = acos(Eigen::Vector3f::UnitZ().dot(normal));
-    if (angle < 0.15)
+    bool horizontal = (angle < 0.15);
+    if (horizontal)
     {
       ROS_DEBUG("Removing a plane with %d points.", static_cast<int>(inliers->indices.size()));
 
-      // new support object, with cluster, bounding box, and plane
-      grasping_msgs::Object object;
-      pcl::toROSMsg(plane, object.point_cluster);
-      // give the object a temporary name
-      object.name = std::string("surface") + boost::lexical_cast<std::string>(supports.size());
-      // add shape and pose
-      shape_msgs::SolidPrimitive box;
-      geometry_msgs::Pose pose;
-      extractUnorientedBoundingBox(plane, box, pose);
-      object.primitives.push_back(box);
-      object.primitive_poses.push_back(pose);
-      // add plane
-      for (int i = 0; i < 4; ++i)
-        object.surface.coef[i] = coefficients->values[i];
-      // stamp and frame
-      object.header.stamp = ros::Time::now();
-      object.header.frame_id = cloud->header.frame_id;
-      // add support surface to object list
-      supports.push_back(object);
-
-      if (output_clouds)
-      {
-        ROS_DEBUG("Adding support cluster of size %d.", static_cast<int>(plane.points.size()));
-        float hue = (360.0 / 8) * supports.size();
-        colorizeCloud(plane, hue);
-        support_cloud += plane;
-      }
+      // Only supports need the plane points copied out
+      pcl::PointCloud<pcl::PointXYZRGB> plane;
+      pcl::copyPointCloud(*cloud_filtered, *inliers, plane);
+      addSupport(plane, coefficients, cloud->header.frame_id, supports, support_cloud, output_clouds);
 
       // track plane for later use when determining objects
       plane_coefficients.push_back(coefficients);
     }
     else
     {
-      // Add plane to temporary point cloud so we can recover points for object extraction below
+      // Points stay available for object extraction below
       ROS_DEBUG("Plane is not horizontal");
-      *non_horizontal_planes += plane;
     }
 
-    // Extract the non-planar parts and proceed
-    extract.setNegative(true);
-    extract.filter(*cloud_filtered);
+    // Mask out the plane and proceed
+    for (size_t i = 0; i < inliers->indices.size(); ++i)
+    {
+      is_plane[inliers->indices[i]] = true;
+      is_support[inliers->indices[i]] = horizontal;
+    }
+    size_t num_remaining = 0;
+    for (size_t i = 0; i < remaining->indices.size(); ++i)
+    {
+      if (!is_plane[remaining->indices[i]])
+        remaining->indices[num_remaining++] = remaining->indices[i];
+    }
+    remaining->indices.resize(num_remaining);
   }
-  ROS_DEBUG("Cloud now %d points.", static_cast<int>(cloud_filtered->points.size()));
-
-  // Add the non-horizontal planes back in
-  *cloud_filtered += *non_horizontal_planes;
+  ROS_DEBUG("Cloud now %d points.", static_cast<int>(remaining->indices.size()));
+  planes_timer.stop();
 
-  // Cluster
-  std::vector<pcl::PointIndices> clusters;
+  // Cluster everything but the supports, including non-horizontal planes
+  ScopedStageTimer clustering_timer(times, STAGE_CLUSTERING);
+  pcl::PointIndices::Ptr object_indices(new pcl::PointIndices);
+  object_indices->indices.reserve(cloud_filtered->points.size());
+  for (size_t i = 0; i < is_support.size(); ++i)
+  {
+    if (!is_support[i])
+      object_indices->indices.push_back(i);
+  }
   extract_clusters_.setInputCloud(cloud_filtered);
+  extract_clusters_.setIndices(object_indices);
   extract_clusters_.extract(clusters);
-  ROS_DEBUG("Extracted %d clusters.", static_cast<int>(clusters.size()));
+  object_points = cloud_filtered;
+}
 
-  extract_indices_.setInputCloud(cloud_filtered);
-  for (size_t i= 0; i < clusters.size(); i++)
+void ObjectSupportSegmentation::segmentOrganized(
+  const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud,
+  std::vector<grasping_msgs::Object>& supports,
+  pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+  bool output_clouds,
+  std::vector<pcl::ModelCoefficients::Ptr>& plane_coefficients,
+  pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& object_points,
+  std::vector<pcl::PointIndices>& clusters,
+  StageTimes* times)
+{
+  // Apply the same height limits as the voxel grid, but keep the image
+  // structure by invalidating points rather than removing them
+  ScopedStageTimer normals_timer(times, STAGE_NORMALS);
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_culled(new pcl::PointCloud<pcl::PointXYZRGB>(*cloud));
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  size_t valid = 0;
+  for (size_t i = 0; i < cloud_culled->points.size(); ++i)
   {
-    // Extract object
-    pcl::PointCloud<pcl::PointXYZRGB> new_cloud;
-    extract_indices_.setIndices(pcl::PointIndicesPtr(new pcl::PointIndices(clusters[i])));
-    extract_indices_.filter(new_cloud);
-
-    // Find centroid
-    Eigen::Vector4f centroid;
-    pcl::compute3DCentroid(new_cloud, centroid);
-
-    // Compare centroid to planes to find which plane we are supported by
-    int support_plane_index = -1;
-    double support_plane_distance = 1000.0;
-    for (int p = 0; p < plane_coefficients.size(); ++p)
+    pcl::PointXYZRGB& p = cloud_culled->points[i];
+    if (pcl_isfinite(p.z) && p.z >= 0.0 && p.z <= 1.8)
     {
-      double distance = distancePointToPlane(centroid, plane_coefficients[p]);
-      if (distance > 0.0 && distance < support_plane_distance)
-      {
-        support_plane_distance = distance;
-        support_plane_index = p;
-      }
+      ++valid;
+      continue;
     }
+    p.x = p.y = p.z = nan;
+  }
+  cloud_culled->is_dense = false;
+  ROS_DEBUG("Filtered for transformed Z, now %d valid points.", static_cast<int>(valid));
 
-    if (support_plane_index == -1)
-    {
-      ROS_DEBUG("No support plane found for object");
+  // Normals from integral images, no neighbor search required
+  pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
+  normal_estimation_.setInputCloud(cloud_culled);
+  normal_estimation_.compute(*normals);
+  normals_timer.stop();
+
+  // Find all planes in a single pass
+  ScopedStageTimer planes_timer(times, STAGE_PLANES);
+  std::vector<pcl::PlanarRegion<pcl::PointXYZRGB>,
+              Eigen::aligned_allocator<pcl::PlanarRegion<pcl::PointXYZRGB> > > regions;
+  std::vector<pcl::ModelCoefficients> model_coefficients;
+  std::vector<pcl::PointIndices> inlier_indices;
+  pcl::PointCloud<pcl::Label>::Ptr labels(new pcl::PointCloud<pcl::Label>);
+  std::vector<pcl::PointIndices> label_indices;
+  std::vector<pcl::PointIndices> boundary_indices;
+  multi_plane_segmentation_.setMinInliers(valid / 8);
+  multi_plane_segmentation_.setInputNormals(normals);
+  multi_plane_segmentation_.setInputCloud(cloud_culled);
+  multi_plane_segmentation_.segmentAndRefine(regions, model_coefficients, inlier_indices,
+                                             labels, label_indices, boundary_indices);
+  ROS_DEBUG("Found %d planes.", static_cast<int>(inlier_indices.size()));
+
+  // Horizontal planes become supports and are excluded from the clustering,
+  // other planes are left in so that they can be part of objects
+  std::vector<bool> exclude_labels(label_indices.size(), false);
+  for (size_t i = 0; i < inlier_indices.size(); ++i)
+  {
+    if (inlier_indices[i].indices.empty())
       continue;
-    }
 
-    // new object, with cluster and bounding box
-    grasping_msgs::Object object;
-    // set name of supporting surface
-    object.support_surface = std::string("surface") + boost::lexical_cast<std::string>(support_plane_index);
-    // add shape, pose and transformed cluster
-    shape_msgs::SolidPrimitive box;
-    geometry_msgs::Pose pose;
-    pcl::PointCloud<pcl::PointXYZRGB> projected_cloud;
-    extractShape(new_cloud, plane_coefficients[support_plane_index], projected_cloud, box, pose);
-    pcl::toROSMsg(projected_cloud, object.point_cluster);
-    object.primitives.push_back(box);
-    object.primitive_poses.push_back(pose);
-    // add stamp and frame
-    object.header.stamp = ros::Time::now();
-    object.header.frame_id = cloud->header.frame_id;
-    // add object to object list
-    objects.push_back(object);
+    // Planes are oriented toward the viewpoint, we want them facing up
+    pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients(model_coefficients[i]));
+    if (coefficients->values[2] < 0.0)
+    {
+      for (int j = 0; j < 4; ++j)
+        coefficients->values[j] = -coefficients->values[j];
+    }
 
-    if (output_clouds)
+    // Check plane is mostly horizontal
+    Eigen::Vector3f normal(coefficients->values[0], coefficients->values[1], coefficients->values[2]);
+    float angle = acos(Eigen::Vector3f::UnitZ().dot(normal));
+    if (angle >= 0.15)
     {
-      ROS_DEBUG("Adding an object cluster of size %d.", static_cast<int>(new_cloud.points.size()));
-      float hue = (360.0 / clusters.size()) * i;
-      colorizeCloud(new_cloud, hue);
-      object_cloud += new_cloud;
+      ROS_DEBUG("Plane is not horizontal");
+      continue;
     }
+
+    ROS_DEBUG("Removing a plane with %d points.", static_cast<int>(inlier_indices[i].indices.size()));
+    pcl::PointCloud<pcl::PointXYZRGB> plane;
+    pcl::copyPointCloud(*cloud_culled, inlier_indices[i], plane);
+    addSupport(plane, coefficients, cloud->header.frame_id, supports, support_cloud, output_clouds);
+
+    // track plane for later use when determining objects
+    plane_coefficients.push_back(coefficients);
+
+    unsigned label = labels->points[inlier_indices[i].indices[0]].label;
+    if (label < exclude_labels.size())
+      exclude_labels[label] = true;
   }
 
-  ROS_INFO("object support segmentation done processing.");
-  return true;
+  planes_timer.stop();
+
+  // Cluster remaining points by connected components in the image
+  ScopedStageTimer clustering_timer(times, STAGE_CLUSTERING);
+  pcl::EuclideanClusterComparator<pcl::PointXYZRGB, pcl::Normal, pcl::Label>::Ptr comparator(
+    new pcl::EuclideanClusterComparator<pcl::PointXYZRGB, pcl::Normal, pcl::Label>());
+  comparator->setInputCloud(cloud_culled);
+  comparator->setLabels(labels);
+  comparator->setExcludeLabels(exclude_labels);
+  comparator->setDistanceThreshold(cluster_tolerance_, false);
+
+  pcl::PointCloud<pcl::Label> cluster_labels;
+  std::vector<pcl::PointIndices> cluster_indices;
+  pcl::OrganizedConnectedComponentSegmentation<pcl::PointXYZRGB, pcl::Label> connected_components(comparator);
+  connected_components.setInputCloud(cloud_culled);
+  connected_components.segment(cluster_labels, cluster_indices);
+
+  for (size_t i = 0; i < cluster_indices.size(); ++i)
+  {
+    if (cluster_indices[i].indices.size() >= static_cast<size_t>(organized_cluster_min_size_))
+      clusters.push_back(cluster_indices[i]);
+  }
+  object_points = cloud_culled;
+}
+
+void ObjectSupportSegmentation::addSupport(
+  pcl::PointCloud<pcl::PointXYZRGB>& plane,
+  const pcl::ModelCoefficients::Ptr& coefficients,
+  const std::string& frame_id,
+  std::vector<grasping_msgs::Object>& supports,
+  pcl::PointCloud<pcl::PointXYZRGB>& support_cloud,
+  bool output_clouds)
+{
+  // new support object, with cluster, bounding box, and plane
+  grasping_msgs::Object object;
+  pcl::toROSMsg(plane, object.point_cluster);
+  // give the object a temporary name
+  object.name = std::string("surface") + boost::lexical_cast<std::string>(supports.size());
+  // add shape and pose
+  shape_msgs::SolidPrimitive box;
+  geometry_msgs::Pose pose;
+  extractUnorientedBoundingBox(plane, box, pose);
+  object.primitives.push_back(box);
+  object.primitive_poses.push_back(pose);
+  // add plane
+  for (int i = 0; i < 4; ++i)
+    object.surface.coef[i] = coefficients->values[i];
+  // stamp and frame
+  object.header.stamp = ros::Time::now();
+  object.header.frame_id = frame_id;
+  // add support surface to object list
+  supports.push_back(object);
+
+  if (output_clouds)
+  {
+    ROS_DEBUG("Adding support cluster of size %d.", static_cast<int>(plane.points.size()));
+    float hue = (360.0 / 8) * supports.size();
+    colorizeCloud(plane, hue);
+    support_cloud += plane;
+  }
 }
 
 }  // namespace ubr1_grasping
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Eigenvalues>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/bind.hpp>
+
+#include <ubr1_grasping/parallel_plane_ransac.h>
+
+namespace ubr1_grasping
+{
+
+// Hypotheses scored between termination checks. This does not depend on
+// the number of threads, so that the result does not either.
+static const size_t BATCH_SIZE = 32;
+
+ParallelPlaneRansac::ParallelPlaneRansac() :
+  threshold_(0.01),
+  max_iterations_(50),
+  probability_(0.99),
+  optimize_(true),
+  threads_(0),
+  seed_(0)
+{
+}
+
+void ParallelPlaneRansac::setInputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud)
+{
+  input_ = cloud;
+  indices_.reset();
+}
+
+void ParallelPlaneRansac::setIndices(const pcl::PointIndices::ConstPtr& indices)
+{
+  indices_ = indices;
+}
+
+void ParallelPlaneRansac::setDistanceThreshold(double threshold)
+{
+  threshold_ = threshold;
+}
+
+void ParallelPlaneRansac::setMaxIterations(int max_iterations)
+{
+  max_iterations_ = max_iterations;
+}
+
+void ParallelPlaneRansac::setProbability(double probability)
+{
+  probability_ = probability;
+}
+
+void ParallelPlaneRansac::setOptimizeCoefficients(bool optimize)
+{
+  optimize_ = optimize;
+}
+
+void ParallelPlaneRansac::setNumberOfThreads(unsigned int threads)
+{
+  threads_ = threads;
+  thread_pool_.reset();
+}
+
+void ParallelPlaneRansac::setThreadPool(const boost::shared_ptr<ThreadPool>& pool)
+{
+  thread_pool_ = pool;
+}
+
+void ParallelPlaneRansac::setSeed(unsigned int seed)
+{
+  seed_ = seed;
+}
+
+void ParallelPlaneRansac::segment(pcl::PointIndices& inliers, pcl::ModelCoefficients& coefficients)
+{
+  inliers.indices.clear();
+  coefficients.values.clear();
+  if (!input_)
+    return;
+  inliers.header = coefficients.header = input_->header;
+
+  // Copy points into structure of arrays
+  size_t size = indices_ ? indices_->indices.size() : input_->points.size();
+  x_.resize(size);
+  y_.resize(size);
+  z_.resize(size);
+  point_indices_.resize(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    int index = indices_ ? indices_->indices[i] : static_cast<int>(i);
+    const pcl::PointXYZRGB& p = input_->points[index];
+    x_[i] = p.x;
+    y_[i] = p.y;
+    z_[i] = p.z;
+    point_indices_[i] = index;
+  }
+  if (size < 3)
+    return;
+
+  // Workers are only started once
+  if (!thread_pool_)
+    thread_pool_.reset(new ThreadPool(threads_));
+
+  boost::random::mt19937 rng(seed_);
+  boost::random::uniform_int_distribution<size_t> sample(0, size - 1);
+
+  Eigen::Vector4f best_plane = Eigen::Vector4f::Zero();
+  size_t best_score = 0;
+  double required = max_iterations_;
+  int iterations = 0;
+  hypotheses_.resize(BATCH_SIZE);
+  scores_.resize(BATCH_SIZE);
+  while (iterations < std::min(required, static_cast<double>(max_iterations_)))
+  {
+    // Draw hypotheses, degenerate samples count as an iteration but score zero
+    size_t batch_size = std::min(BATCH_SIZE, static_cast<size_t>(max_iterations_ - iterations));
+    for (size_t h = 0; h < batch_size; ++h)
+    {
+      size_t i0 = sample(rng), i1 = sample(rng), i2 = sample(rng);
+      if (i0 == i1 || i0 == i2 || i1 == i2 || !computePlane(i0, i1, i2, hypotheses_[h]))
+        hypotheses_[h].setZero();
+    }
+    iterations += batch_size;
+
+    // Score in parallel
+    thread_pool_->run(batch_size, boost::bind(&ParallelPlaneRansac::scoreHypothesis, this, _1));
+
+    // Take the first best, so ties break the same way every time
+    for (size_t h = 0; h < batch_size; ++h)
+    {
+      if (scores_[h] > best_score)
+      {
+        best_score = scores_[h];
+        best_plane = hypotheses_[h];
+      }
+    }
+
+    // Adaptive termination from the best inlier ratio so far
+    if (best_score > 0)
+    {
+      double w = static_cast<double>(best_score) / size;
+      double p_no_outliers = std::max(std::numeric_limits<double>::epsilon(),
+                                      std::min(1.0 - std::numeric_limits<double>::epsilon(),
+                                               1.0 - w * w * w));
+      required = std::log(1.0 - probability_) / std::log(p_no_outliers);
+    }
+  }
+
+  if (best_score < 3)
+    return;
+
+  if (optimize_)
+  {
+    // Least squares refit to the inliers
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d sum_sq = Eigen::Matrix3d::Zero();
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+      float d = best_plane[0] * x_[i] + best_plane[1] * y_[i] + best_plane[2] * z_[i] + best_plane[3];
+      if (std::fabs(d) <= threshold_)
+      {
+        Eigen::Vector3d p(x_[i], y_[i], z_[i]);
+        sum += p;
+        sum_sq += p * p.transpose();
+        ++count;
+      }
+    }
+    Eigen::Vector3d centroid = sum / count;
+    Eigen::Matrix3d covariance = sum_sq / count - centroid * centroid.transpose();
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+    Eigen::Vector3d normal = solver.eigenvectors().col(0);
+    if ((normal.array() == normal.array()).all())
+    {
+      // keep the orientation of the hypothesis
+      if (normal.dot(best_plane.head<3>().cast<double>()) < 0)
+        normal = -normal;
+      best_plane.head<3>() = normal.cast<float>();
+      best_plane[3] = -normal.dot(centroid);
+    }
+  }
+
+  // Output inliers of the final plane
+  for (size_t i = 0; i < size; ++i)
+  {
+    float d = best_plane[0] * x_[i] + best_plane[1] * y_[i] + best_plane[2] * z_[i] + best_plane[3];
+    if (std::fabs(d) <= threshold_)
+      inliers.indices.push_back(point_indices_[i]);
+  }
+  coefficients.values.resize(4);
+  for (int i = 0; i < 4; ++i)
+    coefficients.values[i] = best_plane[i];
+}
+
+bool ParallelPlaneRansac::computePlane(size_t i0, size_t i1, size_t i2, Eigen::Vector4f& plane) const
+{
+  Eigen::Vector3f p0(x_[i0], y_[i0], z_[i0]);
+  Eigen::Vector3f normal = (Eigen::Vector3f(x_[i1], y_[i1], z_[i1]) - p0).cross(
+                            Eigen::Vector3f(x_[i2], y_[i2], z_[i2]) - p0);
+  float norm = normal.norm();
+  if (norm < 1e-9 || !(norm == norm))
+    return false;
+  normal /= norm;
+  plane << normal, -normal.dot(p0);
+  return true;
+}
+
+size_t ParallelPlaneRansac::countInliers(const Eigen::Vector4f& plane) const
+{
+  // Kept as a plain loop over contiguous floats so the compiler vectorizes
+  // it, this file is built with -O3 (see CMakeLists.txt)
+  const float a = plane[0], b = plane[1], c = plane[2], d = plane[3];
+  const float t = threshold_;
+  const float* x = &x_[0];
+  const float* y = &y_[0];
+  const float* z = &z_[0];
+  const size_t size = x_.size();
+  unsigned int count = 0;
+  for (size_t i = 0; i < size; ++i)
+    count += (std::fabs(a * x[i] + b * y[i] + c * z[i] + d) <= t);
+  return count;
+}
+
+void ParallelPlaneRansac::scoreHypothesis(size_t index)
+{
+  if (hypotheses_[index].head<3>().isZero())
+    scores_[index] = 0;
+  else
+    scores_[index] = countInliers(hypotheses_[index]);
+}
+
+}  // namespace ubr1_grasping
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include <boost/static_assert.hpp>
+#include <ubr1_grasping/reachability_map.h>
+
+namespace ubr1_grasping
+{
+
+const char MAGIC[8] = {'U', 'B', 'R', 'R', 'E', 'A', 'C', 'H'};
+const uint32_t VERSION = 1;
+
+// 8 x 8 bins fill the 64 bit mask, each bin is about 25 degrees across
+const uint32_t ELEVATION_BINS = 8;
+const uint32_t AZIMUTH_BINS = 8;
+
+// Cells follow the header directly, and must stay aligned when mapped
+BOOST_STATIC_ASSERT(sizeof(ReachabilityMapHeader) % sizeof(uint64_t) == 0);
+
+// Whether a fixed size name field holds a terminated string
+bool isTerminated(const char* name, size_t size)
+{
+  return memchr(name, '\0', size) != NULL;
+}
+
+ReachabilityMap::ReachabilityMap() :
+  header_(NULL),
+  cells_(NULL),
+  inverse_resolution_(0.0),
+  mapped_(NULL),
+  mapped_size_(0)
+{
+}
+
+ReachabilityMap::~ReachabilityMap()
+{
+  clear();
+}
+
+void ReachabilityMap::create(const std::string& frame_id,
+                             const std::string& tip_frame_id,
+                             const Eigen::Vector3f& min_corner,
+                             const Eigen::Vector3f& max_corner,
+                             float resolution)
+{
+  clear();
+
+  ReachabilityMapHeader& h = header_storage_;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.elevation_bins = ELEVATION_BINS;
+  h.azimuth_bins = AZIMUTH_BINS;
+  h.resolution = resolution;
+  for (int i = 0; i < 3; ++i)
+    h.origin[i] = min_corner(i);
+  h.size_x = static_cast<uint32_t>(ceil((max_corner.x() - min_corner.x()) / resolution));
+  h.size_y = static_cast<uint32_t>(ceil((max_corner.y() - min_corner.y()) / resolution));
+  h.size_z = static_cast<uint32_t>(ceil((max_corner.z() - min_corner.z()) / resolution));
+  strncpy(h.frame_id, frame_id.c_str(), sizeof(h.frame_id) - 1);
+  strncpy(h.tip_frame_id, tip_frame_id.c_str(), sizeof(h.tip_frame_id) - 1);
+  strncpy(h.base_frame_id, frame_id.c_str(), sizeof(h.base_frame_id) - 1);
+
+  storage_.assign(static_cast<size_t>(h.size_x) * h.size_y * h.size_z, 0);
+  header_ = &header_storage_;
+  cells_ = storage_.empty() ? NULL : &storage_[0];
+  inverse_resolution_ = 1.0 / resolution;
+}
+
+void ReachabilityMap::setLift(const std::string& base_frame_id,
+                              const Eigen::Vector3f& origin,
+                              const Eigen::Vector3f& axis,
+                              float min, float max)
+{
+  // Only maps created in memory can be changed
+  if (mapped_)
+    return;
+
+  ReachabilityMapHeader& h = header_storage_;
+  memset(h.base_frame_id, 0, sizeof(h.base_frame_id));
+  strncpy(h.base_frame_id, base_frame_id.c_str(), sizeof(h.base_frame_id) - 1);
+  for (int i = 0; i < 3; ++i)
+  {
+    h.lift_origin[i] = origin(i);
+    h.lift_axis[i] = axis(i);
+  }
+  h.lift_min = min;
+  h.lift_max = max;
+}
+
+void ReachabilityMap::add(const Eigen::Vector3f& position, const Eigen::Vector3f& approach)
+{
+  // Only maps created in memory can be changed
+  if (mapped_)
+    return;
+  int index = getIndex(position);
+  if (index >= 0)
+    storage_[index] |= getOrientationBit(approach);
+}
+
+bool ReachabilityMap::save(const std::string& filename) const
+{
+  if (!header_)
+    return false;
+
+  FILE* f = fopen(filename.c_str(), "wb");
+  if (!f)
+    return false;
+
+  size_t cells = static_cast<size_t>(header_->size_x) * header_->size_y * header_->size_z;
+  bool ok = (fwrite(header_, sizeof(ReachabilityMapHeader), 1, f) == 1) &&
+            (fwrite(cells_, sizeof(uint64_t), cells, f) == cells);
+  return (fclose(f) == 0) && ok;
+}
+
+bool ReachabilityMap::load(const std::string& filename)
+{
+  clear();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ReachabilityMapHeader))
+  {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  mapped_ = data;
+  mapped_size_ = st.st_size;
+
+  // Check the file is a map of this version and is complete. Every field
+  //  comes from the file, so names must end within their fields, and the
+  //  size of the grid is checked against the file without overflowing.
+  const ReachabilityMapHeader* h = static_cast<const ReachabilityMapHeader*>(data);
+  size_t max_cells = (mapped_size_ - sizeof(ReachabilityMapHeader)) / sizeof(uint64_t);
+  if (memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      h->version != VERSION ||
+      h->elevation_bins == 0 || h->azimuth_bins == 0 ||
+      h->elevation_bins > 64 || h->azimuth_bins > 64 / h->elevation_bins ||
+      !(h->resolution > 0.0) ||
+      !isTerminated(h->frame_id, sizeof(h->frame_id)) ||
+      !isTerminated(h->base_frame_id, sizeof(h->base_frame_id)) ||
+      !isTerminated(h->tip_frame_id, sizeof(h->tip_frame_id)) ||
+      h->size_x == 0 || h->size_y == 0 || h->size_z == 0 ||
+      h->size_x > max_cells ||
+      h->size_y > max_cells / h->size_x ||
+      h->size_z > max_cells / (static_cast<size_t>(h->size_x) * h->size_y) ||
+      mapped_size_ != sizeof(ReachabilityMapHeader) +
+                      static_cast<size_t>(h->size_x) * h->size_y * h->size_z * sizeof(uint64_t))
+  {
+    clear();
+    return false;
+  }
+
+  header_ = h;
+  cells_ = reinterpret_cast<const uint64_t*>(h + 1);
+  inverse_resolution_ = 1.0 / h->resolution;
+  return true;
+}
+
+uint64_t ReachabilityMap::getOrientationBit(const Eigen::Vector3f& approach) const
+{
+  if (!header_)
+    return 0;
+
+  // Bands of equal height on the unit sphere have equal area
+  float norm = approach.norm();
+  if (norm <= 0.0)
+    return 0;
+  float z = approach.z() / norm;
+  int elevation = static_cast<int>((z + 1.0) * 0.5 * header_->elevation_bins);
+  if (elevation >= static_cast<int>(header_->elevation_bins))
+    elevation = header_->elevation_bins - 1;
+
+  float angle = atan2(approach.y(), approach.x());
+  int azimuth = static_cast<int>((angle + M_PI) / (2.0 * M_PI) * header_->azimuth_bins);
+  if (azimuth >= static_cast<int>(header_->azimuth_bins))
+    azimuth = header_->azimuth_bins - 1;
+
+  return static_cast<uint64_t>(1) << (elevation * header_->azimuth_bins + azimuth);
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Isometry3d& pose) const
+{
+  return isReachable(pose.translation().cast<float>(),
+                     pose.linear().col(0).cast<float>());
+}
+
+bool ReachabilityMap::isReachableFromBase(const Eigen::Isometry3d& pose, double lift) const
+{
+  if (!header_)
+    return false;
+
+  // The lift only translates the map frame
+  Eigen::Vector3f origin(header_->lift_origin[0], header_->lift_origin[1], header_->lift_origin[2]);
+  Eigen::Vector3f axis(header_->lift_axis[0], header_->lift_axis[1], header_->lift_axis[2]);
+  Eigen::Vector3f position = pose.translation().cast<float>() - origin - axis * lift;
+  return isReachable(position, pose.linear().col(0).cast<float>());
+}
+
+bool ReachabilityMap::isReachableFromBase(const Eigen::Isometry3d& pose) const
+{
+  if (!header_)
+    return false;
+
+  // Steps of one voxel, so every voxel the pose passes through is checked
+  uint64_t bit = getOrientationBit(pose.linear().col(0).cast<float>());
+  Eigen::Vector3f origin(header_->lift_origin[0], header_->lift_origin[1], header_->lift_origin[2]);
+  Eigen::Vector3f axis(header_->lift_axis[0], header_->lift_axis[1], header_->lift_axis[2]);
+  Eigen::Vector3f position = pose.translation().cast<float>() - origin;
+  for (float lift = header_->lift_min; ; lift += header_->resolution)
+  {
+    if (lift > header_->lift_max)
+      lift = header_->lift_max;
+    if (getMask(position - axis * lift) & bit)
+      return true;
+    if (lift >= header_->lift_max)
+      return false;
+  }
+}
+
+size_t ReachabilityMap::getReachableCount() const
+{
+  if (!header_)
+    return 0;
+  size_t count = 0;
+  size_t cells = static_cast<size_t>(header_->size_x) * header_->size_y * header_->size_z;
+  for (size_t i = 0; i < cells; ++i)
+    if (cells_[i])
+      ++count;
+  return count;
+}
+
+void ReachabilityMap::clear()
+{
+  if (mapped_)
+    munmap(mapped_, mapped_size_);
+  mapped_ = NULL;
+  mapped_size_ = 0;
+  storage_.clear();
+  header_ = NULL;
+  cells_ = NULL;
+  inverse_resolution_ = 0.0;
+}
+
+}  // namespace ubr1_grasping
@@ -30,9 +30,11 @@
 // Author: Michael Ferguson
 
 #include <math.h>
+#include <algorithm>
+#include <limits>
 #include <Eigen/Eigen>
-#include <pcl/filters/project_inliers.h>
-#include <pcl/surface/convex_hull.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
 #include <ubr1_grasping/shape_extraction.h>
 
 namespace ubr1_grasping
@@ -44,6 +46,20 @@ bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
                   shape_msgs::SolidPrimitive& shape,
                   geometry_msgs::Pose& pose)
 {
+  ShapeExtractionBuffers buffers;
+  return extractShape(input, model, output, shape, pose, buffers);
+}
+
+bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
+                  const pcl::ModelCoefficients::Ptr model,
+                  pcl::PointCloud<pcl::PointXYZRGB>& output,
+                  shape_msgs::SolidPrimitive& shape,
+                  geometry_msgs::Pose& pose,
+                  ShapeExtractionBuffers& buffers)
+{
+  if (input.empty())
+    return false;
+
   // Used to decide between various shapes
   double min_volume = 1000.0;  // the minimum volume shape found thus far.
   Eigen::Matrix3f transformation;  // the transformation for the best-fit shape
@@ -59,103 +75,61 @@ bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
       height = distance_to_plane;
   }
 
-  // Project object into 2d, using plane model coefficients
-  pcl::PointCloud<pcl::PointXYZRGB>::Ptr flat(new pcl::PointCloud<pcl::PointXYZRGB>);
-  pcl::ProjectInliers<pcl::PointXYZRGB> projection;
-  projection.setModelType(pcl::SACMODEL_PLANE);
-  projection.setInputCloud(input.makeShared());  // stupid API
-  projection.setModelCoefficients(model);
-  projection.filter(*flat);
-
   // Rotate plane so that Z=0
-  pcl::PointCloud<pcl::PointXYZRGB>::Ptr flat_projected(new pcl::PointCloud<pcl::PointXYZRGB>);
   Eigen::Vector3f normal(model->values[0], model->values[1], model->values[2]);
   Eigen::Quaternionf qz; qz.setFromTwoVectors(normal, Eigen::Vector3f::UnitZ());
   Eigen::Matrix3f plane_rotation = qz.toRotationMatrix();
   Eigen::Matrix3f inv_plane_rotation = plane_rotation.inverse();
 
-  for (size_t i = 0; i < flat->size(); ++i)
-  {
-    pcl::PointXYZRGB p;
-    p.getVector3fMap() = plane_rotation * (*flat)[i].getVector3fMap();
-    flat_projected->push_back(p);
-  }
+  // Project object into 2d. Projecting onto the plane only changes the
+  //  rotated z, so x and y can be taken directly from the rotated points.
+  std::vector<Eigen::Vector2f>& flat = buffers.points;
+  flat.resize(input.size());
+  for (size_t i = 0; i < input.size(); ++i)
+    flat[i] = (plane_rotation * input[i].getVector3fMap()).head<2>();
+
+  // Height of the plane, in the rotated frame
+  const Eigen::Vector3f p0 = input[0].getVector3fMap();
+  float plane_z = (plane_rotation * (p0 - (normal.dot(p0) + model->values[3]) * normal))(2);
 
   // Find the convex hull
-  pcl::PointCloud<pcl::PointXYZRGB> hull;
-  pcl::ConvexHull<pcl::PointXYZRGB> convex_hull;
-  convex_hull.setInputCloud(flat_projected);
-  convex_hull.setDimension(2);
-  convex_hull.reconstruct(hull);
+  std::vector<Eigen::Vector2f>& hull = buffers.hull;
+  convexHull2D(flat, hull);
 
   // Try fitting a rectangle
-  shape_msgs::SolidPrimitive rect;  // the best-fit rectangle
-  rect.type = rect.BOX;
-  rect.dimensions.resize(3);
-  for (size_t i = 0; i < hull.size() - 1; ++i)
+  Eigen::Vector2f axis, min_corner, max_corner;
+  if (minimumAreaRectangle(hull, axis, min_corner, max_corner))
   {
-    // For each pair of hull points, determine the angle
-    double rise = hull[i+1].y - hull[i].y;
-    double run = hull[i+1].x - hull[i].x;
-    // and normalize..
-    {
-      double l = sqrt((rise * rise) + (run * run));
-      rise = rise/l;
-      run = run/l;
-    }
+    shape_msgs::SolidPrimitive rect;  // the best-fit rectangle
+    rect.type = rect.BOX;
+    rect.dimensions.resize(3);
 
     // Build rotation matrix from change of basis
     Eigen::Matrix3f rotation;
-    rotation(0, 0) = run;
-    rotation(0, 1) = rise;
+    rotation(0, 0) = axis(0);
+    rotation(0, 1) = axis(1);
     rotation(0, 2) = 0.0;
-    rotation(1, 0) = -rise;
-    rotation(1, 1) = run;
+    rotation(1, 0) = -axis(1);
+    rotation(1, 1) = axis(0);
     rotation(1, 2) = 0.0;
     rotation(2, 0) = 0.0;
     rotation(2, 1) = 0.0;
     rotation(2, 2) = 1.0;
     Eigen::Matrix3f inv_rotation = rotation.inverse();
 
-    // Project hull to new coordinate system
-    pcl::PointCloud<pcl::PointXYZRGB> projected_cloud;
-    for (size_t j = 0; j < hull.size(); ++j)
-    {
-      pcl::PointXYZRGB p;
-      p.getVector3fMap() = rotation * hull[j].getVector3fMap();
-      projected_cloud.push_back(p);
-    }
-
-    // Compute min/max
-    double x_min = 1000.0;
-    double x_max = -1000.0;
-    double y_min = 1000.0;
-    double y_max = -1000.0;
-    for (size_t j = 0; j < projected_cloud.size(); ++j)
-    {
-      if (projected_cloud[j].x < x_min)
-        x_min = projected_cloud[j].x;
-      if (projected_cloud[j].x > x_max)
-        x_max = projected_cloud[j].x;
-
-      if (projected_cloud[j].y < y_min)
-        y_min = projected_cloud[j].y;
-      if (projected_cloud[j].y > y_max)
-        y_max = projected_cloud[j].y;
-    }
-
     // Is this the best estimate?
-    double area = (x_max - x_min) * (y_max - y_min);
+    Eigen::Vector2f size = max_corner - min_corner;
+    double area = size(0) * size(1);
     if (area*height < min_volume)
     {
       transformation = inv_plane_rotation * inv_rotation;
 
-      rect.dimensions[0] = (x_max - x_min);
-      rect.dimensions[1] = (y_max - y_min);
+      rect.dimensions[0] = size(0);
+      rect.dimensions[1] = size(1);
       rect.dimensions[2] = height;
 
-      Eigen::Vector3f pose3f((x_max + x_min)/2.0, (y_max + y_min)/2.0,
-                             projected_cloud[0].z + height/2.0);
+      Eigen::Vector2f center = (max_corner + min_corner) / 2.0;
+      Eigen::Vector3f pose3f(center(0), center(1), plane_z + height/2.0);
       pose3f = transformation * pose3f;
       pose.position.x = pose3f(0);
       pose.position.y = pose3f(1);
@@ -173,46 +147,31 @@ bool extractShape(const pcl::PointCloud<pcl::PointXYZRGB>& input,
   }
 
   // Try fitting a cylinder
-  shape_msgs::SolidPrimitive cylinder;  // the best-fit cylinder
-  cylinder.type = cylinder.CYLINDER;
-  cylinder.dimensions.resize(2);
-  for (size_t i = 0; i < hull.size(); ++i)
+  Eigen::Vector2f center;
+  float radius;
+  if (minimumEnclosingCircle(hull, center, radius))
   {
-    for (size_t j = i + 1; j < hull.size(); ++j)
+    shape_msgs::SolidPrimitive cylinder;  // the best-fit cylinder
+    cylinder.type = cylinder.CYLINDER;
+    cylinder.dimensions.resize(2);
+
+    // Is this cylinder the best match?
+    double volume = M_PI * radius * radius * height;
+    if (volume < min_volume)
     {
-      // For each pair of hull points determine the center point
-      //  between them as a possible cylinder
-      pcl::PointXYZRGB p;
-      p.x = (hull[i].x + hull[j].x) / 2.0;
-      p.y = (hull[i].y + hull[j].y) / 2.0;
-      double radius = 0.0;
-      // Find radius from this point
-      for (size_t k = 0; k < hull.size(); ++k)
-      {
-        double dx = hull[k].x - p.x;
-        double dy = hull[k].y - p.y;
-        double r = sqrt((dx * dx) + (dy * dy));
-        if (r > radius)
-          radius = r;
-      }
-      // Is this cylinder the best match?
-      double volume = M_PI * radius * radius * height;
-      if (volume < min_volume)
-      {
-        transformation = inv_plane_rotation;
+      transformation = inv_plane_rotation;
 
-        cylinder.dimensions[0] = height;
-        cylinder.dimensions[1] = radius;
+      cylinder.dimensions[0] = height;
+      cylinder.dimensions[1] = radius;
 
-        Eigen::Vector3f pose3f(p.x, p.y, hull[0].z + height/2.0);
-        pose3f = transformation * pose3f;
-        pose.position.x = pose3f(0);
-        pose.position.y = pose3f(1);
-        pose.position.z = pose3f(2);
+      Eigen::Vector3f pose3f(center(0), center(1), plane_z + height/2.0);
+      pose3f = transformation * pose3f;
+      pose.position.x = pose3f(0);
+      pose.position.y = pose3f(1);
+      pose.position.z = pose3f(2);
 
-        min_volume = volume;
-        shape = cylinder;
-      }
+      min_volume = volume;
+      shape = cylinder;
     }
   }
 
@@ -291,4 +250,211 @@ bool extractUnorientedBoundingBox(const pcl::PointCloud<pcl::PointXYZRGB>& input
   return true;
 }
 
+bool minimumAreaRectangle(const std::vector<Eigen::Vector2f>& hull,
+                          Eigen::Vector2f& axis,
+                          Eigen::Vector2f& min_corner,
+                          Eigen::Vector2f& max_corner)
+{
+  const size_t n = hull.size();
+  if (n == 0)
+    return false;
+
+  // A single point, or all points the same
+  axis = Eigen::Vector2f::UnitX();
+  min_corner = max_corner = hull[0];
+
+  // Calipers: furthest along the edge, furthest from the edge, and
+  //  furthest back along the edge. Each only moves forward around the
+  //  hull, so the total work is linear in the number of vertices.
+  size_t right = 0, top = 0, left = 0;
+  bool first = true;
+  double best_area = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < n; ++i)
+  {
+    Eigen::Vector2f edge = hull[(i + 1) % n] - hull[i];
+    float length = edge.norm();
+    if (length <= 0.0)
+      continue;
+    Eigen::Vector2f u = edge / length;
+    Eigen::Vector2f v(-u(1), u(0));
+
+    // On the first edge, each caliper starts where the previous one stopped
+    if (first)
+      right = i;
+    for (size_t k = 0; k < n && u.dot(hull[(right + 1) % n]) > u.dot(hull[right]); ++k)
+      right = (right + 1) % n;
+    if (first)
+      top = right;
+    for (size_t k = 0; k < n && v.dot(hull[(top + 1) % n]) > v.dot(hull[top]); ++k)
+      top = (top + 1) % n;
+    if (first)
+      left = top;
+    for (size_t k = 0; k < n && u.dot(hull[(left + 1) % n]) < u.dot(hull[left]); ++k)
+      left = (left + 1) % n;
+    first = false;
+
+    Eigen::Vector2f min_uv(u.dot(hull[left]), v.dot(hull[i]));
+    Eigen::Vector2f max_uv(u.dot(hull[right]), v.dot(hull[top]));
+    // Only take a later edge if it is better by more than rounding error
+    double area = (max_uv(0) - min_uv(0)) * (max_uv(1) - min_uv(1));
+    if (area < best_area * (1.0 - 1e-4))
+    {
+      best_area = area;
+      axis = u;
+      min_corner = min_uv;
+      max_corner = max_uv;
+    }
+  }
+
+  return true;
+}
+
+namespace
+{
+
+// Lexicographic order, for the monotone chain
+bool lessXY(const Eigen::Vector2f& a, const Eigen::Vector2f& b)
+{
+  return a(0) < b(0) || (a(0) == b(0) && a(1) < b(1));
+}
+
+// Positive if o -> a -> b turns counter-clockwise
+float cross(const Eigen::Vector2f& o, const Eigen::Vector2f& a, const Eigen::Vector2f& b)
+{
+  return (a(0) - o(0)) * (b(1) - o(1)) - (a(1) - o(1)) * (b(0) - o(0));
+}
+
+}  // namespace
+
+void convexHull2D(std::vector<Eigen::Vector2f>& points,
+                  std::vector<Eigen::Vector2f>& hull)
+{
+  std::sort(points.begin(), points.end(), lessXY);
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  const size_t n = points.size();
+  if (n < 3)
+  {
+    hull.assign(points.begin(), points.end());
+    return;
+  }
+
+  // Andrew's monotone chain, lower hull then upper hull
+  hull.resize(2 * n);
+  size_t k = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0)
+      --k;
+    hull[k++] = points[i];
+  }
+  for (size_t i = n - 1, lower = k + 1; i > 0; --i)
+  {
+    while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0)
+      --k;
+    hull[k++] = points[i - 1];
+  }
+
+  // Last point is the same as the first
+  hull.resize(k - 1);
+}
+
+namespace
+{
+
+// Circle with two points on its diameter
+void circleFromTwo(const Eigen::Vector2d& a, const Eigen::Vector2d& b,
+                   Eigen::Vector2d& center, double& radius_sq)
+{
+  center = (a + b) / 2.0;
+  radius_sq = (a - center).squaredNorm();
+}
+
+// Circle through three points, falls back to the widest pair if collinear
+void circleFromThree(const Eigen::Vector2d& a, const Eigen::Vector2d& b, const Eigen::Vector2d& c,
+                     Eigen::Vector2d& center, double& radius_sq)
+{
+  Eigen::Vector2d ab = b - a;
+  Eigen::Vector2d ac = c - a;
+  double d = 2.0 * (ab(0) * ac(1) - ab(1) * ac(0));
+  if (fabs(d) < 1e-12)
+  {
+    // take the pair furthest apart
+    circleFromTwo(a, b, center, radius_sq);
+    Eigen::Vector2d other_center;
+    double other_radius_sq;
+    circleFromTwo(a, c, other_center, other_radius_sq);
+    if (other_radius_sq > radius_sq)
+    {
+      center = other_center;
+      radius_sq = other_radius_sq;
+    }
+    circleFromTwo(b, c, other_center, other_radius_sq);
+    if (other_radius_sq > radius_sq)
+    {
+      center = other_center;
+      radius_sq = other_radius_sq;
+    }
+    return;
+  }
+  double ab_sq = ab.squaredNorm();
+  double ac_sq = ac.squaredNorm();
+  Eigen::Vector2d offset((ac(1) * ab_sq - ab(1) * ac_sq) / d,
+                         (ab(0) * ac_sq - ac(0) * ab_sq) / d);
+  center = a + offset;
+  radius_sq = offset.squaredNorm();
+}
+
+}  // namespace
+
+bool minimumEnclosingCircle(const std::vector<Eigen::Vector2f>& points,
+                            Eigen::Vector2f& center,
+                            float& radius)
+{
+  if (points.empty())
+    return false;
+
+  // Shuffle, so the expected time is linear whatever order the points are in
+  std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > p(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    p[i] = points[i].cast<double>();
+  boost::random::mt19937 rng(0);
+  for (size_t i = p.size() - 1; i > 0; --i)
+  {
+    boost::random::uniform_int_distribution<size_t> pick(0, i);
+    std::swap(p[i], p[pick(rng)]);
+  }
+
+  // Iterative Welzl, allow a little slack for rounding
+  const double epsilon = 1e-12;
+  Eigen::Vector2d c = p[0];
+  double r_sq = 0.0;
+  for (size_t i = 1; i < p.size(); ++i)
+  {
+    if ((p[i] - c).squaredNorm() <= r_sq + epsilon)
+      continue;
+    // p[i] is on the boundary
+    c = p[i];
+    r_sq = 0.0;
+    for (size_t j = 0; j < i; ++j)
+    {
+      if ((p[j] - c).squaredNorm() <= r_sq + epsilon)
+        continue;
+      // p[i] and p[j] are on the boundary
+      circleFromTwo(p[i], p[j], c, r_sq);
+      for (size_t k = 0; k < j; ++k)
+      {
+        if ((p[k] - c).squaredNorm() <= r_sq + epsilon)
+          continue;
+        // p[i], p[j] and p[k] are on the boundary
+        circleFromThree(p[i], p[j], p[k], c, r_sq);
+      }
+    }
+  }
+
+  center = c.cast<float>();
+  radius = sqrt(r_sq);
+  return true;
+}
+
 }  // namespace ubr1_grasping
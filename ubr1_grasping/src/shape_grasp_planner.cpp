@@ -72,87 +72,71 @@ moveit_msgs::GripperTranslation makeGripperTranslation(std::string frame,
 }
 
 
-Eigen::Quaterniond quaternionFromEuler(float yaw, float pitch, float roll)
-{
-  float sy = sin(yaw*0.5);
-  float cy = cos(yaw*0.5);
-  float sp = sin(pitch*0.5);
-  float cp = cos(pitch*0.5);
-  float sr = sin(roll*0.5);
-  float cr = cos(roll*0.5);
-  float w = cr*cp*cy + sr*sp*sy;
-  float x = sr*cp*cy - cr*sp*sy;
-  float y = cr*sp*cy + sr*cp*sy;
-  float z = cr*cp*sy - sr*sp*cy;
-  return Eigen::Quaterniond(w,x,y,z);
-}
-
-
 ShapeGraspPlanner::ShapeGraspPlanner(double gripper_max_opening,
                                      double gripper_finger_depth) :
     max_opening_(gripper_max_opening),
     finger_depth_(gripper_finger_depth)
 {
-}
+  // rotate by 0, pitch, 0 then apply grasp point -> wrist_roll offset
+  const double pitches[NUM_PITCHES] = {0.0, 0.5, 1.57/2.0, 1.07, 1.57};
+  for (int i = 0; i < NUM_PITCHES; ++i)
+  {
+    pitch_offsets_[i] = Eigen::AngleAxisd(pitches[i], Eigen::Vector3d::UnitY()) *
+                        Eigen::Translation3d(-0.110, 0, 0);
+  }
 
-int ShapeGraspPlanner::createGrasp(const geometry_msgs::PoseStamped& pose,
-                                   double gripper_pitch,
-                                   double x_offset,
-                                   double z_offset,
-                                   double quality)
-{
-  moveit_msgs::Grasp grasp;
-  grasp.grasp_pose = pose;
+  // rotate -90 degrees about Z axis
+  side_rotation_ = Eigen::AngleAxisd(-1.57, Eigen::Vector3d::UnitZ());
 
   // defaults
-  grasp.pre_grasp_posture = makeGraspPosture(max_opening_);
-  grasp.grasp_posture = makeGraspPosture(0.0);
-  grasp.pre_grasp_approach = makeGripperTranslation("wrist_roll_link", 0.1, 0.15);
-  grasp.post_grasp_retreat = makeGripperTranslation("wrist_roll_link", 0.1, 0.15, -1.0);
-
-  // initial pose
-  Eigen::Affine3d p = Eigen::Translation3d(pose.pose.position.x,
-                                           pose.pose.position.y,
-                                           pose.pose.position.z) *
-                        Eigen::Quaterniond(pose.pose.orientation.w,
-                                           pose.pose.orientation.x,
-                                           pose.pose.orientation.y,
-                                           pose.pose.orientation.z);
-  // translate by x_offset, 0, z_offset
-  p = p * Eigen::Translation3d(x_offset, 0, z_offset);
-  // rotate by 0, pitch, 0
-  p = p * quaternionFromEuler(0.0, gripper_pitch, 0.0);
-  // apply grasp point -> wrist_roll offset
-  p = p * Eigen::Translation3d(-0.110, 0, 0);
-
-  grasp.grasp_pose.pose.position.x = p.translation().x();
-  grasp.grasp_pose.pose.position.y = p.translation().y();
-  grasp.grasp_pose.pose.position.z = p.translation().z();
-  Eigen::Quaterniond q = (Eigen::Quaterniond)p.linear();
-  grasp.grasp_pose.pose.orientation.x = q.x();
-  grasp.grasp_pose.pose.orientation.y = q.y();
-  grasp.grasp_pose.pose.orientation.z = q.z();
-  grasp.grasp_pose.pose.orientation.w = q.w();
-
-  grasp.grasp_quality = quality;
-
-  grasps_.push_back(grasp);
-  return 1;
+  grasp_template_.pre_grasp_posture = makeGraspPosture(max_opening_);
+  grasp_template_.grasp_posture = makeGraspPosture(0.0);
+  grasp_template_.pre_grasp_approach = makeGripperTranslation("wrist_roll_link", 0.1, 0.15);
+  grasp_template_.post_grasp_retreat = makeGripperTranslation("wrist_roll_link", 0.1, 0.15, -1.0);
+}
+
+void ShapeGraspPlanner::createGrasps(const std_msgs::Header& header,
+                                     const Eigen::Isometry3d& pose,
+                                     const std::vector<Candidate>& candidates,
+                                     std::vector<moveit_msgs::Grasp>& grasps) const
+{
+  size_t start = grasps.size();
+  grasps.resize(start + candidates.size(), grasp_template_);
+  for (size_t i = 0; i < candidates.size(); ++i)
+  {
+    const Candidate& c = candidates[i];
+
+    // translate by x_offset, 0, z_offset, then apply the pitch offset
+    Eigen::Isometry3d p = pose * Eigen::Translation3d(c.x_offset, 0, c.z_offset) * pitch_offsets_[c.pitch];
+
+    moveit_msgs::Grasp& grasp = grasps[start + i];
+    grasp.grasp_pose.header = header;
+    grasp.grasp_pose.pose.position.x = p.translation().x();
+    grasp.grasp_pose.pose.position.y = p.translation().y();
+    grasp.grasp_pose.pose.position.z = p.translation().z();
+    Eigen::Quaterniond q(p.linear());
+    grasp.grasp_pose.pose.orientation.x = q.x();
+    grasp.grasp_pose.pose.orientation.y = q.y();
+    grasp.grasp_pose.pose.orientation.z = q.z();
+    grasp.grasp_pose.pose.orientation.w = q.w();
+
+    grasp.grasp_quality = c.quality;
+  }
 }
 
 // Create the grasps going in one direction around an object
 // starts with gripper level, rotates it up
 // this works for boxes and cylinders
 int ShapeGraspPlanner::createGraspSeries(
-  const geometry_msgs::PoseStamped& pose,
   double depth, double width, double height,
-  bool use_vertical)
+  std::vector<Candidate>& candidates,
+  bool use_vertical) const
 {
-  int count = 0;
+  size_t start = candidates.size();
 
   // Gripper opening is limited
   if (width >= (max_opening_*0.9))
-    return count;
+    return 0;
 
   // Depth of grasp calculations
   double x = depth/2.0;
@@ -166,32 +150,32 @@ int ShapeGraspPlanner::createGraspSeries(
   for (double step = 0.0; step < depth/2.0; step += 0.1)
   {
     if (use_vertical)
-      count += createGrasp(pose, 1.57, step, -z, 1.0 - 0.1*step);  // vertical
-    count += createGrasp(pose, 1.07, step, -z + 0.01, 0.7 - 0.1*step);  // slightly angled down
+      candidates.push_back(Candidate(PITCH_VERTICAL, step, -z, 1.0 - 0.1*step));  // vertical
+    candidates.push_back(Candidate(PITCH_ANGLED_DOWN, step, -z + 0.01, 0.7 - 0.1*step));  // slightly angled down
     if (step > 0.05)
     {
       if (use_vertical)
-        count += createGrasp(pose, 1.57, -step, -z, 1.0 - 0.1*step);
-      count += createGrasp(pose, 1.07, -step, -z + 0.01, 0.7 - 0.1*step);
+        candidates.push_back(Candidate(PITCH_VERTICAL, -step, -z, 1.0 - 0.1*step));
+      candidates.push_back(Candidate(PITCH_ANGLED_DOWN, -step, -z + 0.01, 0.7 - 0.1*step));
     }
   }
 
   // Grasp horizontally along side of box
   for (double step = 0.0; step < height/2.0; step += 0.1)
   {
-    count += createGrasp(pose, 0.0, x, step, 0.8 - 0.1*step);  // horizontal
-    count += createGrasp(pose, 0.5, x-0.01, step, 0.6 - 0.1*step);  // slightly angled up
+    candidates.push_back(Candidate(PITCH_HORIZONTAL, x, step, 0.8 - 0.1*step));  // horizontal
+    candidates.push_back(Candidate(PITCH_ANGLED_UP, x-0.01, step, 0.6 - 0.1*step));  // slightly angled up
     if (step > 0.05)
     {
-      count += createGrasp(pose, 0.0, x, -step, 0.8 - 0.1*step);
-      count += createGrasp(pose, 0.5, x-0.01, -step, 0.6 - 0.1*step);
+      candidates.push_back(Candidate(PITCH_HORIZONTAL, x, -step, 0.8 - 0.1*step));
+      candidates.push_back(Candidate(PITCH_ANGLED_UP, x-0.01, -step, 0.6 - 0.1*step));
     }
   }
 
   // A grasp on the corner of the box
-  count += createGrasp(pose, 1.57/2.0, x - 0.005, -z + 0.005, 0.25);
+  candidates.push_back(Candidate(PITCH_CORNER, x - 0.005, -z + 0.005, 0.25));
 
-  return count;
+  return candidates.size() - start;
 }
 
 int ShapeGraspPlanner::plan(const grasping_msgs::Object& object,
@@ -213,19 +197,15 @@ int ShapeGraspPlanner::plan(const grasping_msgs::Object& object,
     return -1;
   }
 
-  // Clear out internal vector
-  grasps_.clear();
-
-  // Setup Pose
-  geometry_msgs::PoseStamped grasp_pose;
-  grasp_pose.header = object.header;
-  grasp_pose.pose = object.primitive_poses[0];
-
-  // Setup object orientation
-  Eigen::Quaterniond q(object.primitive_poses[0].orientation.w,
-                       object.primitive_poses[0].orientation.x,
-                       object.primitive_poses[0].orientation.y,
-                       object.primitive_poses[0].orientation.z);
+  // Setup object pose
+  const geometry_msgs::Pose& object_pose = object.primitive_poses[0];
+  Eigen::Isometry3d pose = Eigen::Translation3d(object_pose.position.x,
+                                                object_pose.position.y,
+                                                object_pose.position.z) *
+                           Eigen::Quaterniond(object_pose.orientation.w,
+                                              object_pose.orientation.x,
+                                              object_pose.orientation.y,
+                                              object_pose.orientation.z);
 
   // Setup object dimensions
   double x, y, z;
@@ -241,32 +221,24 @@ int ShapeGraspPlanner::plan(const grasping_msgs::Object& object,
     z = object.primitives[0].dimensions[SolidPrimitive::CYLINDER_HEIGHT];
   }
 
-  // Generate grasps
+  // Generate grasps, grasps are generated into a local vector so plan() is reentrant
+  std::vector<moveit_msgs::Grasp> object_grasps;
+  std::vector<Candidate> candidates;
   for (int i = 0; i < 4; ++i)
   {
-    grasp_pose.pose.orientation.x = q.x();
-    grasp_pose.pose.orientation.y = q.y();
-    grasp_pose.pose.orientation.z = q.z();
-    grasp_pose.pose.orientation.w = q.w();
-
-    if (i < 2)
-    {
-      createGraspSeries(grasp_pose, x, y, z);
-    }
-    else
-    {
-      // Only two sets of unqiue vertical grasps
-      createGraspSeries(grasp_pose, x, y, z, false);
-    }
+    // Only two sets of unqiue vertical grasps
+    candidates.clear();
+    createGraspSeries(x, y, z, candidates, i < 2);
+    createGrasps(object.header, pose, candidates, object_grasps);
 
     // Next iteration, rotate 90 degrees about Z axis
-    q = q * quaternionFromEuler(-1.57, 0.0, 0.0);
+    pose = pose * side_rotation_;
     std::swap(x, y);
   }
 
   ROS_INFO("shape grasp planning done.");
 
-  grasps = grasps_;
+  grasps.swap(object_grasps);
   return grasps.size();  // num of grasps
 }
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#include <algorithm>
+#include <cstdio>
+
+#include <ubr1_grasping/stage_timer.h>
+
+namespace ubr1_grasping
+{
+
+const char* STAGE_NAMES[NUM_STAGES] =
+{
+  "wait",
+  "range_filter",
+  "transform",
+  "voxelize",
+  "normals",
+  "planes",
+  "clustering",
+  "shapes",
+  "grasp_planning",
+  "reachability"
+};
+
+const char* getStageName(int stage)
+{
+  return (stage >= 0 && stage < NUM_STAGES) ? STAGE_NAMES[stage] : "unknown";
+}
+
+StageStatistics::StageStatistics(size_t window) :
+  window_(std::max(static_cast<size_t>(1), window))
+{
+  for (int i = 0; i < NUM_STAGES; ++i)
+  {
+    samples_[i].reserve(window_);
+    next_[i] = 0;
+    count_[i] = 0;
+  }
+}
+
+void StageStatistics::add(const StageTimes& times)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  for (int i = 0; i < NUM_STAGES; ++i)
+  {
+    if (times.ms[i] < 0.0)
+      continue;
+    if (samples_[i].size() < window_)
+      samples_[i].push_back(times.ms[i]);
+    else
+      samples_[i][next_[i]] = times.ms[i];
+    next_[i] = (next_[i] + 1) % window_;
+    ++count_[i];
+  }
+}
+
+void StageStatistics::getStatus(diagnostic_msgs::DiagnosticStatus& status)
+{
+  // Copy out, so sorting does not hold up the threads adding times
+  std::vector<double> samples[NUM_STAGES];
+  unsigned long count[NUM_STAGES];
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i = 0; i < NUM_STAGES; ++i)
+    {
+      samples[i] = samples_[i];
+      count[i] = count_[i];
+    }
+  }
+
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "Latency of the last runs of each stage, in ms";
+  status.values.clear();
+  for (int i = 0; i < NUM_STAGES; ++i)
+  {
+    std::vector<double>& s = samples[i];
+    if (s.empty())
+      continue;
+    std::sort(s.begin(), s.end());
+
+    double mean = 0.0;
+    for (size_t j = 0; j < s.size(); ++j)
+      mean += s[j] / s.size();
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "count %lu, mean %.2f, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f",
+             count[i], mean,
+             s[s.size() / 2],
+             s[std::min(s.size() - 1, s.size() * 9 / 10)],
+             s[std::min(s.size() - 1, s.size() * 99 / 100)],
+             s.back());
+
+    diagnostic_msgs::KeyValue value;
+    value.key = getStageName(i);
+    value.value = buffer;
+    status.values.push_back(value);
+  }
+}
+
+}  // namespace ubr1_grasping
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <ubr1_grasping/voxel_clustering.h>
+
+namespace ubr1_grasping
+{
+
+namespace
+{
+
+// Pack cell coordinates into a key, 21 bits per axis
+inline boost::uint64_t cellKey(boost::int64_t x, boost::int64_t y, boost::int64_t z)
+{
+  return (static_cast<boost::uint64_t>(x + (1 << 20)) & 0x1fffff) << 42 |
+         (static_cast<boost::uint64_t>(y + (1 << 20)) & 0x1fffff) << 21 |
+         (static_cast<boost::uint64_t>(z + (1 << 20)) & 0x1fffff);
+}
+
+// Sort clusters by decreasing size, as pcl::EuclideanClusterExtraction does
+bool largerCluster(const pcl::PointIndices& a, const pcl::PointIndices& b)
+{
+  return a.indices.size() > b.indices.size();
+}
+
+}  // namespace
+
+VoxelClustering::VoxelClustering() :
+  tolerance_(0.01),
+  min_size_(1),
+  max_size_(std::numeric_limits<int>::max())
+{
+}
+
+void VoxelClustering::setInputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr& cloud)
+{
+  input_ = cloud;
+  indices_.reset();
+}
+
+void VoxelClustering::setIndices(const pcl::PointIndices::ConstPtr& indices)
+{
+  indices_ = indices;
+}
+
+void VoxelClustering::setClusterTolerance(double tolerance)
+{
+  tolerance_ = tolerance;
+}
+
+void VoxelClustering::setMinClusterSize(int min_size)
+{
+  min_size_ = min_size;
+}
+
+void VoxelClustering::setMaxClusterSize(int max_size)
+{
+  max_size_ = max_size;
+}
+
+void VoxelClustering::extract(std::vector<pcl::PointIndices>& clusters)
+{
+  clusters.clear();
+  if (!input_ || tolerance_ <= 0.0)
+    return;
+
+  const int size = indices_ ? indices_->indices.size() : input_->points.size();
+  // Cells are a little larger than the tolerance, so that rounding in the
+  // cell computation can never put two neighbors more than one cell apart
+  const float inverse_tolerance = 1.0 / (tolerance_ * (1.0 + 1e-4));
+  // Same radius as pcl::KdTreeFLANN, which squares in double, then rounds to float
+  const float tolerance_sq = static_cast<float>(tolerance_ * tolerance_);
+
+  // Bucket points into cells, storing the cell coordinates of each cell
+  boost::unordered_map<boost::uint64_t, int> cell_map;
+  cell_map.rehash(size / 2);
+  std::vector<boost::int64_t> cell_coords;
+  cell_of_point_.resize(size);
+  for (int i = 0; i < size; ++i)
+  {
+    const pcl::PointXYZRGB& p = input_->points[indices_ ? indices_->indices[i] : i];
+    boost::int64_t x = static_cast<boost::int64_t>(floor(p.x * inverse_tolerance));
+    boost::int64_t y = static_cast<boost::int64_t>(floor(p.y * inverse_tolerance));
+    boost::int64_t z = static_cast<boost::int64_t>(floor(p.z * inverse_tolerance));
+    std::pair<boost::unordered_map<boost::uint64_t, int>::iterator, bool> inserted =
+      cell_map.insert(std::make_pair(cellKey(x, y, z), static_cast<int>(cell_map.size())));
+    if (inserted.second)
+    {
+      cell_coords.push_back(x);
+      cell_coords.push_back(y);
+      cell_coords.push_back(z);
+    }
+    cell_of_point_[i] = inserted.first->second;
+  }
+
+  // Points of each cell stored contiguously
+  const int num_cells = cell_map.size();
+  cell_start_.assign(num_cells + 1, 0);
+  for (int i = 0; i < size; ++i)
+    ++cell_start_[cell_of_point_[i] + 1];
+  for (int c = 0; c < num_cells; ++c)
+    cell_start_[c + 1] += cell_start_[c];
+  cell_points_.resize(size);
+  {
+    std::vector<int> fill(cell_start_.begin(), cell_start_.end() - 1);
+    for (int i = 0; i < size; ++i)
+      cell_points_[fill[cell_of_point_[i]]++] = i;
+  }
+
+  // Each point starts in its own set
+  parent_.resize(size);
+  rank_.assign(size, 0);
+  for (int i = 0; i < size; ++i)
+    parent_[i] = i;
+
+  // Join points within tolerance, looking at each pair of adjacent cells once
+  for (int c = 0; c < num_cells; ++c)
+  {
+    for (int dx = 0; dx <= 1; ++dx)
+    {
+      for (int dy = (dx == 0 ? 0 : -1); dy <= 1; ++dy)
+      {
+        for (int dz = (dx == 0 && dy == 0 ? 0 : -1); dz <= 1; ++dz)
+        {
+          boost::unordered_map<boost::uint64_t, int>::const_iterator neighbor =
+            cell_map.find(cellKey(cell_coords[3 * c] + dx, cell_coords[3 * c + 1] + dy, cell_coords[3 * c + 2] + dz));
+          if (neighbor == cell_map.end())
+            continue;
+          const int n = neighbor->second;
+
+          for (int a = cell_start_[c]; a < cell_start_[c + 1]; ++a)
+          {
+            const int i = cell_points_[a];
+            const pcl::PointXYZRGB& p = input_->points[indices_ ? indices_->indices[i] : i];
+            // within the same cell, only look at later points
+            for (int b = (n == c ? a + 1 : cell_start_[n]); b < cell_start_[n + 1]; ++b)
+            {
+              const int j = cell_points_[b];
+              const pcl::PointXYZRGB& q = input_->points[indices_ ? indices_->indices[j] : j];
+              // Summed in the same order as flann::L2_Simple, neighbors are strictly within the radius
+              float x = p.x - q.x, y = p.y - q.y, z = p.z - q.z;
+              float distance_sq = x * x;
+              distance_sq += y * y;
+              distance_sq += z * z;
+              if (distance_sq < tolerance_sq)
+                join(i, j);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Gather sets into clusters
+  std::vector<int> cluster_of_root(size, -1);
+  std::vector<pcl::PointIndices> sets;
+  for (int i = 0; i < size; ++i)
+  {
+    int root = find(i);
+    if (cluster_of_root[root] < 0)
+    {
+      cluster_of_root[root] = sets.size();
+      sets.push_back(pcl::PointIndices());
+    }
+    sets[cluster_of_root[root]].indices.push_back(indices_ ? indices_->indices[i] : i);
+  }
+
+  for (size_t s = 0; s < sets.size(); ++s)
+  {
+    int cluster_size = sets[s].indices.size();
+    if (cluster_size < min_size_ || cluster_size > max_size_)
+      continue;
+    clusters.push_back(pcl::PointIndices());
+    clusters.back().indices.swap(sets[s].indices);
+    std::sort(clusters.back().indices.begin(), clusters.back().indices.end());
+    clusters.back().header = input_->header;
+  }
+  std::stable_sort(clusters.begin(), clusters.end(), largerCluster);
+}
+
+int VoxelClustering::find(int i)
+{
+  while (parent_[i] != i)
+  {
+    parent_[i] = parent_[parent_[i]];
+    i = parent_[i];
+  }
+  return i;
+}
+
+void VoxelClustering::join(int i, int j)
+{
+  i = find(i);
+  j = find(j);
+  if (i == j)
+    return;
+  if (rank_[i] < rank_[j])
+    std::swap(i, j);
+  parent_[j] = i;
+  if (rank_[i] == rank_[j])
+    ++rank_[i];
+}
+
+}  // namespace ubr1_grasping
@@ -0,0 +1,177 @@
+#!/usr/bin/env python
+
+# Copyright 2014, Unbounded Robotics, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above
+#    copyright notice, this list of conditions and the following
+#    disclaimer in the documentation and/or other materials provided
+#    with the distribution.
+#  * Neither the name of Unbounded Robotics, Inc. nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# Author: Michael Ferguson
+
+"""
+Generate the synthetic point clouds used by the tests, as ASCII PCD
+files in the base_link frame. Each scene is a set of boxes (the floor,
+a table and objects on it) seen by a pinhole camera. Pixels that miss
+every box are NaN, so organized clouds keep the image structure.
+
+Run from this directory to regenerate all clouds:
+
+  ./generate_clouds.py
+"""
+
+import math
+import random
+
+# Box is (x_min, y_min, z_min, x_max, y_max, z_max)
+FLOOR = (-5.0, -5.0, -0.01, 5.0, 5.0, 0.0)
+TABLE = (0.3, -0.6, 0.0, 1.2, 0.6, 0.7)
+
+def box(x, y, z, size_x, size_y, size_z):
+    """ Box centered at x, y and standing on z. """
+    return (x - size_x / 2.0, y - size_y / 2.0, z, x + size_x / 2.0, y + size_y / 2.0, z + size_z)
+
+def cube(x, y, z, size):
+    return box(x, y, z, size, size, size)
+
+# The head camera, looking over the table and onto the floor beyond it,
+#  with depth noise of about 1.5mm at one meter
+HEAD_CAMERA = (0.1, 0.0, 1.35, 0.75)
+HEAD_IMAGE = (128, 96, 125.0)
+HEAD_NOISE = 0.0015
+
+# Two objects, well apart
+SPARSE_OBJECTS = [
+    cube(0.7, 0.15, 0.7, 0.06),
+    box(0.8, -0.15, 0.7, 0.06, 0.06, 0.18),
+]
+
+# Objects of several sizes, a few centimeters apart
+CLUTTER_OBJECTS = [
+    cube(0.6, 0.3, 0.7, 0.05),
+    cube(0.65, 0.15, 0.7, 0.07),
+    box(0.6, 0.0, 0.7, 0.05, 0.05, 0.2),
+    box(0.68, -0.12, 0.7, 0.08, 0.04, 0.1),
+    cube(0.62, -0.28, 0.7, 0.04),
+    box(0.8, 0.25, 0.7, 0.1, 0.06, 0.04),
+    box(0.82, 0.05, 0.7, 0.06, 0.12, 0.14),
+    cube(0.85, -0.2, 0.7, 0.06),
+    box(0.98, 0.15, 0.7, 0.04, 0.04, 0.25),
+    cube(1.0, -0.05, 0.7, 0.08),
+]
+
+def head_scene(objects, organized):
+    return {
+        "camera": HEAD_CAMERA,
+        "image": HEAD_IMAGE,
+        "noise": HEAD_NOISE,
+        "organized": organized,
+        "boxes": [FLOOR, TABLE] + objects,
+    }
+
+# name: camera (x, y, z, pitch down), image (width, height, focal length), noise, boxes
+SCENES = {
+    # Looking straight down at one cube, 0.8cm between pixels on the table
+    "organized_table_box": {
+        "camera": (0.6, 0.0, 1.5, math.pi / 2.0),
+        "image": (64, 48, 100.0),
+        "noise": 0.0,
+        "organized": True,
+        "boxes": [FLOOR, TABLE, cube(0.6, 0.0, 0.7, 0.08)],
+    },
+    # The same views from the head camera, for benchmark_perception
+    "organized_head_sparse": head_scene(SPARSE_OBJECTS, True),
+    "organized_head_clutter": head_scene(CLUTTER_OBJECTS, True),
+    "unorganized_head_sparse": head_scene(SPARSE_OBJECTS, False),
+    "unorganized_head_clutter": head_scene(CLUTTER_OBJECTS, False),
+}
+
+def intersect(origin, direction, box):
+    """ Distance along the ray to the box, or None. """
+    near, far = -1e9, 1e9
+    for i in range(3):
+        if abs(direction[i]) < 1e-12:
+            if origin[i] < box[i] or origin[i] > box[i + 3]:
+                return None
+            continue
+        t1 = (box[i] - origin[i]) / direction[i]
+        t2 = (box[i + 3] - origin[i]) / direction[i]
+        near = max(near, min(t1, t2))
+        far = min(far, max(t1, t2))
+    if near > far or far < 0.0:
+        return None
+    return near if near > 0.0 else None
+
+def render(scene):
+    x, y, z, pitch = scene["camera"]
+    width, height, focal = scene["image"]
+    # Camera looks along +x, pitched down, image x right and y down
+    forward = (math.cos(pitch), 0.0, -math.sin(pitch))
+    right = (0.0, -1.0, 0.0)
+    down = (forward[1] * right[2] - forward[2] * right[1],
+            forward[2] * right[0] - forward[0] * right[2],
+            forward[0] * right[1] - forward[1] * right[0])
+
+    rand = random.Random(42)
+    points = list()
+    for v in range(height):
+        for u in range(width):
+            a = (u - (width - 1) / 2.0) / focal
+            b = (v - (height - 1) / 2.0) / focal
+            d = [forward[i] + a * right[i] + b * down[i] for i in range(3)]
+            hits = [intersect((x, y, z), d, box) for box in scene["boxes"]]
+            hits = [t for t in hits if t is not None]
+            if not hits:
+                points.append(None)
+                continue
+            t = min(hits)
+            # Depth noise grows with the square of depth, as for structured light
+            depth = t + rand.gauss(0.0, scene["noise"] * t * t)
+            points.append(tuple([(x, y, z)[i] + depth * d[i] for i in range(3)]))
+
+    if not scene["organized"]:
+        points = [p for p in points if p is not None]
+        width, height = len(points), 1
+    return width, height, points
+
+def write_pcd(filename, width, height, points):
+    with open(filename, "w") as f:
+        f.write("# .PCD v0.7 - Point Cloud Data file format\n")
+        f.write("VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\n")
+        f.write("WIDTH %d\nHEIGHT %d\nVIEWPOINT 0 0 0 1 0 0 0\n" % (width, height))
+        f.write("POINTS %d\nDATA ascii\n" % len(points))
+        for p in points:
+            if p is None:
+                f.write("nan nan nan\n")
+            else:
+                f.write("%.4f %.4f %.4f\n" % p)
+
+if __name__ == "__main__":
+    for name in sorted(SCENES.keys()):
+        width, height, points = render(SCENES[name])
+        write_pcd(name + ".pcd", width, height, points)
+        print("%s: %d x %d, %d valid points" % (name, width, height,
+              len([p for p in points if p is not None])))
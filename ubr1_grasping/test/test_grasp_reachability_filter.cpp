@@ -0,0 +1,247 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <gtest/gtest.h>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl_parser/kdl_parser.hpp>
+#include <ubr1_grasping/grasp_reachability_filter.h>
+
+using ubr1_grasping::GraspReachabilityFilter;
+using ubr1_grasping::ReachabilityMap;
+using ubr1_grasping::ThreadPool;
+
+// A gantry carrying a wrist, with the tool offset from the wrist so that
+//  the orientation of a grasp changes the position of the wrist
+const char* GANTRY_URDF =
+  "<robot name=\"gantry\">"
+  "  <link name=\"base_link\"/>"
+  "  <link name=\"x_link\"/>"
+  "  <link name=\"y_link\"/>"
+  "  <link name=\"z_link\"/>"
+  "  <link name=\"yaw_link\"/>"
+  "  <link name=\"pitch_link\"/>"
+  "  <link name=\"roll_link\"/>"
+  "  <link name=\"tool_link\"/>"
+  "  <joint name=\"x_joint\" type=\"prismatic\">"
+  "    <parent link=\"base_link\"/><child link=\"x_link\"/><axis xyz=\"1 0 0\"/>"
+  "    <limit lower=\"0\" upper=\"0.5\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"y_joint\" type=\"prismatic\">"
+  "    <parent link=\"x_link\"/><child link=\"y_link\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit lower=\"0\" upper=\"0.5\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"z_joint\" type=\"prismatic\">"
+  "    <parent link=\"y_link\"/><child link=\"z_link\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit lower=\"0\" upper=\"0.5\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"yaw_joint\" type=\"revolute\">"
+  "    <parent link=\"z_link\"/><child link=\"yaw_link\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit lower=\"-2\" upper=\"2\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"pitch_joint\" type=\"revolute\">"
+  "    <parent link=\"yaw_link\"/><child link=\"pitch_link\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit lower=\"-2\" upper=\"2\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"roll_joint\" type=\"revolute\">"
+  "    <parent link=\"pitch_link\"/><child link=\"roll_link\"/><axis xyz=\"1 0 0\"/>"
+  "    <limit lower=\"-2\" upper=\"2\" effort=\"1\" velocity=\"1\"/>"
+  "  </joint>"
+  "  <joint name=\"tool_joint\" type=\"fixed\">"
+  "    <parent link=\"roll_link\"/><child link=\"tool_link\"/><origin xyz=\"0.1 0 0\"/>"
+  "  </joint>"
+  "</robot>";
+
+class GraspReachabilityFilterTests : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(model_.initString(GANTRY_URDF));
+    KDL::Tree tree;
+    ASSERT_TRUE(kdl_parser::treeFromUrdfModel(model_, tree));
+    ASSERT_TRUE(tree.getChain("base_link", "tool_link", chain_));
+    pool_.reset(new ThreadPool(2));
+  }
+
+  // Poses the tool reaches at random configurations within the limits
+  std::vector<KDL::Frame> samplePoses(int count)
+  {
+    double q_min[6] = {0.0, 0.0, 0.0, -2.0, -2.0, -2.0};
+    double q_max[6] = {0.5, 0.5, 0.5, 2.0, 2.0, 2.0};
+
+    boost::mt19937 rng(1);
+    boost::uniform_real<double> dist(0.0, 1.0);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > random(rng, dist);
+
+    KDL::ChainFkSolverPos_recursive fk(chain_);
+    KDL::JntArray q(chain_.getNrOfJoints());
+    std::vector<KDL::Frame> poses(count);
+    for (int i = 0; i < count; ++i)
+    {
+      for (unsigned int j = 0; j < q.rows(); ++j)
+        q(j) = q_min[j] + random() * (q_max[j] - q_min[j]);
+      fk.JntToCart(q, poses[i]);
+    }
+    return poses;
+  }
+
+  moveit_msgs::Grasp makeGrasp(const KDL::Frame& frame, double quality)
+  {
+    moveit_msgs::Grasp grasp;
+    grasp.grasp_pose.header.frame_id = "base_link";
+    grasp.grasp_pose.pose.position.x = frame.p.x();
+    grasp.grasp_pose.pose.position.y = frame.p.y();
+    grasp.grasp_pose.pose.position.z = frame.p.z();
+    frame.M.GetQuaternion(grasp.grasp_pose.pose.orientation.x,
+                          grasp.grasp_pose.pose.orientation.y,
+                          grasp.grasp_pose.pose.orientation.z,
+                          grasp.grasp_pose.pose.orientation.w);
+    grasp.grasp_quality = quality;
+    return grasp;
+  }
+
+  urdf::Model model_;
+  KDL::Chain chain_;
+  boost::shared_ptr<ThreadPool> pool_;
+};
+
+TEST_F(GraspReachabilityFilterTests, test_reachable)
+{
+  GraspReachabilityFilter filter(0.05, 20000, pool_);
+  ASSERT_TRUE(filter.init(model_, "base_link", "tool_link"));
+
+  // Every pose the tool reaches is accepted, though the seed of its
+  //  voxel often has a different orientation
+  std::vector<KDL::Frame> poses = samplePoses(100);
+  for (size_t i = 0; i < poses.size(); ++i)
+    EXPECT_TRUE(filter.isReachable(poses[i])) << "pose " << i;
+
+  // Outside the workspace
+  EXPECT_FALSE(filter.isReachable(KDL::Frame(KDL::Vector(2.0, 0.0, 0.0))));
+  // In the workspace, but turned past the limit of the yaw joint
+  EXPECT_FALSE(filter.isReachable(KDL::Frame(KDL::Rotation::RotZ(2.5),
+                                             KDL::Vector(0.25, 0.25, 0.25))));
+}
+
+TEST_F(GraspReachabilityFilterTests, test_filter)
+{
+  GraspReachabilityFilter filter(0.05, 20000, pool_);
+  ASSERT_TRUE(filter.init(model_, "base_link", "tool_link"));
+
+  std::vector<KDL::Frame> poses = samplePoses(3);
+  std::vector<moveit_msgs::Grasp> grasps;
+  grasps.push_back(makeGrasp(poses[0], 0.2));
+  grasps.push_back(makeGrasp(KDL::Frame(KDL::Vector(2.0, 0.0, 0.0)), 0.9));
+  grasps.push_back(makeGrasp(poses[1], 0.5));
+  grasps.push_back(makeGrasp(poses[2], 0.2));
+
+  // Grasps in other frames cannot be checked, and are kept
+  grasps.push_back(makeGrasp(KDL::Frame(KDL::Vector(2.0, 0.0, 0.0)), 0.1));
+  grasps.back().grasp_pose.header.frame_id = "odom";
+
+  ASSERT_EQ(4, filter.filter(grasps));
+  EXPECT_DOUBLE_EQ(0.5, grasps[0].grasp_quality);
+  // Equal quality keeps the planner order
+  EXPECT_DOUBLE_EQ(poses[0].p.x(), grasps[1].grasp_pose.pose.position.x);
+  EXPECT_DOUBLE_EQ(poses[2].p.x(), grasps[2].grasp_pose.pose.position.x);
+  EXPECT_EQ("odom", grasps[3].grasp_pose.header.frame_id);
+
+  ASSERT_EQ(2, filter.filter(grasps, 2));
+}
+
+TEST_F(GraspReachabilityFilterTests, test_map_file)
+{
+  std::vector<KDL::Frame> poses = samplePoses(100);
+
+  char filename[] = "/tmp/reachability_map_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  // A map holding only the sampled poses
+  {
+    ReachabilityMap map;
+    map.create("base_link", "tool_link",
+               Eigen::Vector3f(-0.2, -0.2, -0.2), Eigen::Vector3f(0.8, 0.8, 0.8), 0.05);
+    for (size_t i = 0; i < poses.size(); ++i)
+    {
+      KDL::Vector x = poses[i].M.UnitX();
+      map.add(Eigen::Vector3f(poses[i].p.x(), poses[i].p.y(), poses[i].p.z()),
+              Eigen::Vector3f(x.x(), x.y(), x.z()));
+    }
+    ASSERT_TRUE(map.save(filename));
+  }
+
+  GraspReachabilityFilter filter(0.05, 20000, pool_);
+  ASSERT_TRUE(filter.init(model_, "base_link", "tool_link", filename));
+  for (size_t i = 0; i < poses.size(); ++i)
+    EXPECT_TRUE(filter.isReachable(poses[i])) << "pose " << i;
+
+  // Loading the map keeps every pose the sampled filter keeps. With wrist
+  //  joints this wide, the fixed seeds alone miss about 1% of poses.
+  GraspReachabilityFilter sampled(0.05, 20000, pool_);
+  ASSERT_TRUE(sampled.init(model_, "base_link", "tool_link"));
+  for (size_t i = 0; i < poses.size(); ++i)
+  {
+    if (sampled.isReachable(poses[i]))
+      EXPECT_TRUE(filter.isReachable(poses[i])) << "pose " << i;
+  }
+
+  // Outside the map, and approaching from a direction not in the map
+  EXPECT_FALSE(filter.isReachable(KDL::Frame(KDL::Vector(2.0, 0.0, 0.0))));
+  EXPECT_FALSE(filter.isReachable(KDL::Frame(poses[0].M * KDL::Rotation::RotZ(M_PI), poses[0].p)));
+
+  // A map for another chain is not used, and the map is sampled instead
+  GraspReachabilityFilter other(0.05, 20000, pool_);
+  ASSERT_TRUE(other.init(model_, "base_link", "roll_link", filename));
+  EXPECT_TRUE(other.isReachable(KDL::Frame(KDL::Vector(0.25, 0.25, 0.25))));
+  EXPECT_FALSE(other.isReachable(KDL::Frame(KDL::Vector(2.0, 0.0, 0.0))));
+
+  unlink(filename);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
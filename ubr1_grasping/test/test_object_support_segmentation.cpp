@@ -0,0 +1,89 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <pcl/io/pcd_io.h>
+#include <ubr1_grasping/object_support_segmentation.h>
+
+using ubr1_grasping::ObjectSupportSegmentation;
+
+// Load a cloud from test/data, see generate_clouds.py
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr loadCloud(const std::string& name)
+{
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+  std::string filename = std::string(TEST_DATA_DIR) + "/" + name + ".pcd";
+  if (pcl::io::loadPCDFile(filename, *cloud) < 0)
+    ADD_FAILURE() << "Unable to load " << filename;
+  cloud->header.frame_id = "base_link";
+  return cloud;
+}
+
+// 8cm cube on a table, seen from above at full resolution
+TEST(ObjectSupportSegmentationTests, test_organized_table_box)
+{
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = loadCloud("organized_table_box");
+  ASSERT_TRUE(cloud->isOrganized());
+
+  // Top of the cube is 144 points, too few for the scaled default
+  boost::shared_ptr<ubr1_grasping::ThreadPool> pool(new ubr1_grasping::ThreadPool(1));
+  ObjectSupportSegmentation segmentation(0.01, 50, true, pool);
+  std::vector<grasping_msgs::Object> objects, supports;
+  pcl::PointCloud<pcl::PointXYZRGB> object_cloud, support_cloud;
+  segmentation.segment(cloud, objects, supports, object_cloud, support_cloud, false);
+  ASSERT_EQ(1, supports.size());
+  EXPECT_NEAR(0.7, -supports[0].surface.coef[3] / supports[0].surface.coef[2], 0.005);
+  EXPECT_EQ(0, objects.size());
+
+  segmentation.setOrganizedClusterMinSize(50);
+  objects.clear();
+  supports.clear();
+  segmentation.segment(cloud, objects, supports, object_cloud, support_cloud, false);
+  ASSERT_EQ(1, supports.size());
+  ASSERT_EQ(1, objects.size());
+  EXPECT_EQ("surface0", objects[0].support_surface);
+  ASSERT_EQ(1, objects[0].primitive_poses.size());
+  EXPECT_NEAR(0.6, objects[0].primitive_poses[0].position.x, 0.01);
+  EXPECT_NEAR(0.0, objects[0].primitive_poses[0].position.y, 0.01);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
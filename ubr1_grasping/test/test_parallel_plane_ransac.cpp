@@ -0,0 +1,176 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include <gtest/gtest.h>
+#include <ubr1_grasping/parallel_plane_ransac.h>
+
+using ubr1_grasping::ParallelPlaneRansac;
+using ubr1_grasping::ThreadPool;
+
+// Tilted plane n.p + d = 0 with gaussian noise, and uniform outliers
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr makePlaneCloud(const Eigen::Vector3f& n, float d,
+                                                      size_t inliers, size_t outliers,
+                                                      float noise)
+{
+  boost::random::mt19937 rng(1234);
+  boost::random::uniform_real_distribution<float> uniform(-1.0, 1.0);
+  boost::random::normal_distribution<float> gaussian(0.0, noise);
+
+  // Two directions in the plane
+  Eigen::Vector3f u = n.unitOrthogonal();
+  Eigen::Vector3f v = n.cross(u);
+
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
+  for (size_t i = 0; i < inliers + outliers; ++i)
+  {
+    Eigen::Vector3f p;
+    if (i < inliers)
+      p = -d * n + uniform(rng) * u + uniform(rng) * v + gaussian(rng) * n;
+    else
+      p = Eigen::Vector3f(uniform(rng), uniform(rng), uniform(rng));
+    pcl::PointXYZRGB point;
+    point.x = p(0);
+    point.y = p(1);
+    point.z = p(2);
+    cloud->points.push_back(point);
+  }
+  cloud->width = cloud->points.size();
+  cloud->height = 1;
+  return cloud;
+}
+
+TEST(ParallelPlaneRansacTests, test_plane_accuracy)
+{
+  Eigen::Vector3f n = Eigen::Vector3f(0.1, -0.2, 1.0).normalized();
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = makePlaneCloud(n, -0.7, 5000, 2000, 0.002);
+
+  ParallelPlaneRansac ransac;
+  ransac.setDistanceThreshold(0.01);
+  ransac.setMaxIterations(100);
+  ransac.setInputCloud(cloud);
+
+  pcl::PointIndices inliers;
+  pcl::ModelCoefficients coefficients;
+  ransac.segment(inliers, coefficients);
+  ASSERT_EQ(4, coefficients.values.size());
+
+  // Normal may point either way
+  Eigen::Vector3f found(coefficients.values[0], coefficients.values[1], coefficients.values[2]);
+  float sign = (found.dot(n) < 0.0) ? -1.0 : 1.0;
+  EXPECT_GT(sign * found.dot(n), std::cos(0.01));
+  EXPECT_NEAR(-0.7, sign * coefficients.values[3], 0.002);
+
+  // All plane points, and few of the outliers, are inliers
+  size_t plane_points = 0;
+  for (size_t i = 0; i < inliers.indices.size(); ++i)
+    plane_points += (inliers.indices[i] < 5000);
+  EXPECT_EQ(5000, plane_points);
+  EXPECT_LT(inliers.indices.size() - plane_points, 100);
+}
+
+TEST(ParallelPlaneRansacTests, test_thread_count_determinism)
+{
+  Eigen::Vector3f n = Eigen::Vector3f(0.0, 0.3, 1.0).normalized();
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = makePlaneCloud(n, 0.2, 2000, 3000, 0.005);
+
+  // Only use every other point, so indices are tested as well
+  pcl::PointIndices::Ptr indices(new pcl::PointIndices);
+  for (size_t i = 0; i < cloud->points.size(); i += 2)
+    indices->indices.push_back(i);
+
+  pcl::PointIndices expected_inliers;
+  pcl::ModelCoefficients expected_coefficients;
+  unsigned int threads[] = {1, 2, 3, 8};
+  for (size_t t = 0; t < sizeof(threads) / sizeof(unsigned int); ++t)
+  {
+    ParallelPlaneRansac ransac;
+    ransac.setDistanceThreshold(0.01);
+    ransac.setMaxIterations(200);
+    ransac.setSeed(7);
+    ransac.setNumberOfThreads(threads[t]);
+    ransac.setInputCloud(cloud);
+    ransac.setIndices(indices);
+
+    // Workers are reused, repeated calls must give the same answer
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+      pcl::PointIndices inliers;
+      pcl::ModelCoefficients coefficients;
+      ransac.segment(inliers, coefficients);
+      ASSERT_EQ(4, coefficients.values.size());
+      if (expected_coefficients.values.empty())
+      {
+        expected_inliers = inliers;
+        expected_coefficients = coefficients;
+        continue;
+      }
+      EXPECT_EQ(expected_inliers.indices, inliers.indices) << threads[t] << " threads";
+      for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(expected_coefficients.values[i], coefficients.values[i]) << threads[t] << " threads";
+    }
+  }
+
+  // A shared pool gives the same answer as well
+  boost::shared_ptr<ThreadPool> pool(new ThreadPool(4));
+  ParallelPlaneRansac ransac;
+  ransac.setDistanceThreshold(0.01);
+  ransac.setMaxIterations(200);
+  ransac.setSeed(7);
+  ransac.setThreadPool(pool);
+  ransac.setInputCloud(cloud);
+  ransac.setIndices(indices);
+  pcl::PointIndices inliers;
+  pcl::ModelCoefficients coefficients;
+  ransac.segment(inliers, coefficients);
+  EXPECT_EQ(expected_inliers.indices, inliers.indices);
+  ASSERT_EQ(4, coefficients.values.size());
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(expected_coefficients.values[i], coefficients.values[i]);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Author: Michael Ferguson
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ubr1_grasping/reachability_map.h>
+
+using ubr1_grasping::ReachabilityMap;
+
+// A small map, with one voxel reachable from straight ahead
+void createMap(ReachabilityMap& map)
+{
+  map.create("torso_lift_link", "wrist_roll_link",
+             Eigen::Vector3f(-1.0, -1.0, -1.0), Eigen::Vector3f(1.0, 1.0, 1.0), 0.1);
+  map.setLift("base_link", Eigen::Vector3f(0.0, 0.0, 0.5), Eigen::Vector3f(0.0, 0.0, 1.0), 0.0, 0.4);
+  map.add(Eigen::Vector3f(0.55, 0.05, 0.05), Eigen::Vector3f(1.0, 0.0, 0.0));
+}
+
+TEST(ReachabilityMapTests, test_query)
+{
+  ReachabilityMap map;
+  createMap(map);
+  EXPECT_EQ(static_cast<size_t>(1), map.getReachableCount());
+
+  // Same voxel, same approach bin
+  EXPECT_TRUE(map.isReachable(Eigen::Vector3f(0.58, 0.02, 0.08), Eigen::Vector3f(0.9, 0.1, 0.05)));
+  // Same voxel, approaching from behind
+  EXPECT_FALSE(map.isReachable(Eigen::Vector3f(0.58, 0.02, 0.08), Eigen::Vector3f(-1.0, 0.0, 0.0)));
+  // Neighboring voxel
+  EXPECT_FALSE(map.isReachable(Eigen::Vector3f(0.65, 0.05, 0.05), Eigen::Vector3f(1.0, 0.0, 0.0)));
+  // Outside the map, including positions that truncate to the first voxel
+  EXPECT_FALSE(map.isReachable(Eigen::Vector3f(5.0, 0.0, 0.0), Eigen::Vector3f(1.0, 0.0, 0.0)));
+  EXPECT_EQ(static_cast<uint64_t>(0), map.getMask(Eigen::Vector3f(-1.05, -1.05, -1.05)));
+
+  // Poses use the X axis of the tip as the approach
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation() = Eigen::Vector3d(0.55, 0.05, 0.05);
+  EXPECT_TRUE(map.isReachable(pose));
+  pose.linear() = Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  EXPECT_FALSE(map.isReachable(pose));
+}
+
+TEST(ReachabilityMapTests, test_lift)
+{
+  ReachabilityMap map;
+  createMap(map);
+
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation() = Eigen::Vector3d(0.55, 0.05, 0.85);
+  EXPECT_TRUE(map.isReachableFromBase(pose, 0.3));
+  EXPECT_FALSE(map.isReachableFromBase(pose, 0.0));
+  EXPECT_TRUE(map.isReachableFromBase(pose));
+
+  // Needs more lift than there is
+  pose.translation().z() = 1.05;
+  EXPECT_FALSE(map.isReachableFromBase(pose));
+}
+
+TEST(ReachabilityMapTests, test_orientation_bits)
+{
+  ReachabilityMap map;
+  createMap(map);
+
+  // Every direction is in exactly one bin
+  uint64_t all = 0;
+  for (int i = 0; i < 10000; ++i)
+  {
+    Eigen::Vector3f d = Eigen::Vector3f::Random();
+    uint64_t bit = map.getOrientationBit(d);
+    EXPECT_EQ(0, bit & (bit - 1));
+    all |= bit;
+  }
+  EXPECT_EQ(~static_cast<uint64_t>(0), all);
+  EXPECT_NE(static_cast<uint64_t>(0), map.getOrientationBit(Eigen::Vector3f(0.0, 0.0, 1.0)));
+  EXPECT_NE(static_cast<uint64_t>(0), map.getOrientationBit(Eigen::Vector3f(-1.0, 0.0, 0.0)));
+}
+
+TEST(ReachabilityMapTests, test_save_load)
+{
+  char filename[] = "/tmp/reachability_map_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  {
+    ReachabilityMap map;
+    createMap(map);
+    ASSERT_TRUE(map.save(filename));
+  }
+
+  ReachabilityMap map;
+  ASSERT_TRUE(map.load(filename));
+  EXPECT_EQ(std::string("torso_lift_link"), map.getHeader()->frame_id);
+  EXPECT_EQ(std::string("base_link"), map.getHeader()->base_frame_id);
+  EXPECT_EQ(static_cast<uint32_t>(20), map.getHeader()->size_x);
+  EXPECT_EQ(static_cast<size_t>(1), map.getReachableCount());
+  EXPECT_TRUE(map.isReachable(Eigen::Vector3f(0.55, 0.05, 0.05), Eigen::Vector3f(1.0, 0.0, 0.0)));
+
+  // Truncated files are rejected
+  ASSERT_EQ(0, truncate(filename, 100));
+  EXPECT_FALSE(map.load(filename));
+  EXPECT_TRUE(map.getHeader() == NULL);
+  EXPECT_FALSE(map.load("/nonexistent/reachability.map"));
+
+  unlink(filename);
+}
+
+// Write a header followed by empty cells, as a corrupt or foreign file might be
+bool writeMap(const char* filename, const ubr1_grasping::ReachabilityMapHeader& header, size_t cells)
+{
+  FILE* f = fopen(filename, "wb");
+  if (!f)
+    return false;
+  std::vector<uint64_t> data(cells, 0);
+  bool ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+            (cells == 0 || fwrite(&data[0], sizeof(uint64_t), cells, f) == cells);
+  return (fclose(f) == 0) && ok;
+}
+
+TEST(ReachabilityMapTests, test_bad_header)
+{
+  char filename[] = "/tmp/reachability_map_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  ReachabilityMap created;
+  createMap(created);
+  const ubr1_grasping::ReachabilityMapHeader valid = *created.getHeader();
+  size_t cells = static_cast<size_t>(valid.size_x) * valid.size_y * valid.size_z;
+
+  ReachabilityMap map;
+  ASSERT_TRUE(writeMap(filename, valid, cells));
+  EXPECT_TRUE(map.load(filename));
+
+  // Names that are not terminated within their fields
+  ubr1_grasping::ReachabilityMapHeader h = valid;
+  memset(h.frame_id, 'x', sizeof(h.frame_id));
+  ASSERT_TRUE(writeMap(filename, h, cells));
+  EXPECT_FALSE(map.load(filename));
+
+  h = valid;
+  memset(h.base_frame_id, 'x', sizeof(h.base_frame_id));
+  ASSERT_TRUE(writeMap(filename, h, cells));
+  EXPECT_FALSE(map.load(filename));
+
+  h = valid;
+  memset(h.tip_frame_id, 'x', sizeof(h.tip_frame_id));
+  ASSERT_TRUE(writeMap(filename, h, cells));
+  EXPECT_FALSE(map.load(filename));
+
+  // A name filling its field, except for the terminator, is fine
+  h = valid;
+  memset(h.tip_frame_id, 'x', sizeof(h.tip_frame_id) - 1);
+  ASSERT_TRUE(writeMap(filename, h, cells));
+  EXPECT_TRUE(map.load(filename));
+
+  // Empty grids, which would otherwise match a header only file
+  h = valid;
+  h.size_y = 0;
+  ASSERT_TRUE(writeMap(filename, h, 0));
+  EXPECT_FALSE(map.load(filename));
+
+  // Sizes whose product overflows to zero, matching a header only file
+  h = valid;
+  h.size_x = h.size_y = h.size_z = 1 << 22;
+  ASSERT_TRUE(writeMap(filename, h, 0));
+  EXPECT_FALSE(map.load(filename));
+
+  // No orientation bins
+  h = valid;
+  h.azimuth_bins = 0;
+  ASSERT_TRUE(writeMap(filename, h, cells));
+  EXPECT_FALSE(map.load(filename));
+  EXPECT_TRUE(map.getHeader() == NULL);
+
+  unlink(filename);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -29,9 +29,67 @@
 
 // Author: Michael Ferguson
 
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <ubr1_grasping/shape_extraction.h>
 
+// Uniform random number in [min, max)
+float randomFloat(float min, float max)
+{
+  return min + (max - min) * (rand() / (RAND_MAX + 1.0f));
+}
+
+// Random convex polygon, counter-clockwise, by sorting angles on an ellipse
+std::vector<Eigen::Vector2f> randomConvexPolygon(size_t size)
+{
+  std::vector<float> angles(size);
+  for (size_t i = 0; i < size; ++i)
+    angles[i] = randomFloat(0.0, 2.0 * M_PI);
+  std::sort(angles.begin(), angles.end());
+
+  float a = randomFloat(0.01, 0.2);
+  float b = randomFloat(0.01, 0.2);
+  float rotation = randomFloat(0.0, 2.0 * M_PI);
+  Eigen::Vector2f offset(randomFloat(-1.0, 1.0), randomFloat(-1.0, 1.0));
+  Eigen::Matrix2f r;
+  r << cos(rotation), -sin(rotation), sin(rotation), cos(rotation);
+
+  std::vector<Eigen::Vector2f> polygon;
+  for (size_t i = 0; i < size; ++i)
+  {
+    Eigen::Vector2f p = r * Eigen::Vector2f(a * cos(angles[i]), b * sin(angles[i])) + offset;
+    if (polygon.empty() || (p - polygon.back()).norm() > 1e-4)
+      polygon.push_back(p);
+  }
+  return polygon;
+}
+
+// Smallest area of a rectangle aligned with any edge, tried one at a time
+double bruteForceArea(const std::vector<Eigen::Vector2f>& hull)
+{
+  double best = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < hull.size(); ++i)
+  {
+    Eigen::Vector2f u = (hull[(i + 1) % hull.size()] - hull[i]).normalized();
+    Eigen::Vector2f v(-u(1), u(0));
+    double min_u = 1000.0, max_u = -1000.0, min_v = 1000.0, max_v = -1000.0;
+    for (size_t j = 0; j < hull.size(); ++j)
+    {
+      min_u = std::min(min_u, static_cast<double>(u.dot(hull[j])));
+      max_u = std::max(max_u, static_cast<double>(u.dot(hull[j])));
+      min_v = std::min(min_v, static_cast<double>(v.dot(hull[j])));
+      max_v = std::max(max_v, static_cast<double>(v.dot(hull[j])));
+    }
+    best = std::min(best, (max_u - min_u) * (max_v - min_v));
+  }
+  return best;
+}
+
 TEST(test_shape_extraction, simple_cube)
 {
   // simple cube 4 corners of cube, plus one extra point
@@ -86,6 +144,191 @@ TEST(test_shape_extraction, simple_cube)
   EXPECT_FLOAT_EQ(1.0, pose.orientation.w);
 }
 
+TEST(test_shape_extraction, convex_hull_random_points)
+{
+  srand(4);
+  std::vector<Eigen::Vector2f> points, hull;
+  for (int trial = 0; trial < 200; ++trial)
+  {
+    points.clear();
+    size_t size = 1 + rand() % 500;
+    for (size_t i = 0; i < size; ++i)
+    {
+      // snap to a grid so there are duplicate and collinear points
+      points.push_back(Eigen::Vector2f(floor(randomFloat(0.0, 0.1) * 200.0) / 200.0,
+                                       floor(randomFloat(0.0, 0.1) * 200.0) / 200.0));
+    }
+    std::vector<Eigen::Vector2f> original = points;
+    ubr1_grasping::convexHull2D(points, hull);
+    ASSERT_FALSE(hull.empty());
+
+    // strictly convex and counter-clockwise
+    for (size_t i = 0; hull.size() >= 3 && i < hull.size(); ++i)
+    {
+      Eigen::Vector2f a = hull[(i + 1) % hull.size()] - hull[i];
+      Eigen::Vector2f b = hull[(i + 2) % hull.size()] - hull[(i + 1) % hull.size()];
+      EXPECT_GT(a(0) * b(1) - a(1) * b(0), 0.0);
+    }
+
+    // every point is inside or on the hull
+    for (size_t j = 0; hull.size() >= 3 && j < original.size(); ++j)
+    {
+      for (size_t i = 0; i < hull.size(); ++i)
+      {
+        Eigen::Vector2f a = hull[(i + 1) % hull.size()] - hull[i];
+        Eigen::Vector2f b = original[j] - hull[i];
+        EXPECT_GE(a(0) * b(1) - a(1) * b(0), -1e-7);
+      }
+    }
+  }
+}
+
+TEST(test_shape_extraction, min_area_rectangle_rotated_box)
+{
+  srand(1);
+  for (int trial = 0; trial < 100; ++trial)
+  {
+    // corners of a rotated box, counter-clockwise
+    float length = randomFloat(0.02, 0.3);
+    float width = randomFloat(0.02, 0.3);
+    float angle = randomFloat(0.0, 2.0 * M_PI);
+    Eigen::Vector2f u(cos(angle), sin(angle));
+    Eigen::Vector2f v(-u(1), u(0));
+    Eigen::Vector2f origin(randomFloat(-1.0, 1.0), randomFloat(-1.0, 1.0));
+    std::vector<Eigen::Vector2f> hull;
+    hull.push_back(origin);
+    hull.push_back(origin + length * u);
+    hull.push_back(origin + length * u + width * v);
+    hull.push_back(origin + width * v);
+
+    Eigen::Vector2f axis, min_corner, max_corner;
+    ASSERT_TRUE(ubr1_grasping::minimumAreaRectangle(hull, axis, min_corner, max_corner));
+
+    // first edge is chosen when all are equally good
+    EXPECT_NEAR(u(0), axis(0), 1e-5);
+    EXPECT_NEAR(u(1), axis(1), 1e-5);
+    EXPECT_NEAR(length, max_corner(0) - min_corner(0), 1e-5);
+    EXPECT_NEAR(width, max_corner(1) - min_corner(1), 1e-5);
+  }
+}
+
+TEST(test_shape_extraction, min_area_rectangle_random_polygons)
+{
+  srand(2);
+  for (int trial = 0; trial < 500; ++trial)
+  {
+    std::vector<Eigen::Vector2f> hull = randomConvexPolygon(3 + rand() % 200);
+    if (hull.size() < 3)
+      continue;
+
+    Eigen::Vector2f axis, min_corner, max_corner;
+    ASSERT_TRUE(ubr1_grasping::minimumAreaRectangle(hull, axis, min_corner, max_corner));
+    EXPECT_NEAR(1.0, axis.norm(), 1e-5);
+
+    // area matches trying every edge
+    double area = (max_corner(0) - min_corner(0)) * (max_corner(1) - min_corner(1));
+    EXPECT_NEAR(bruteForceArea(hull), area, 1e-4 * area);
+
+    // rectangle is no larger than the axis-aligned box
+    Eigen::Vector2f aabb_min = hull[0], aabb_max = hull[0];
+    for (size_t i = 0; i < hull.size(); ++i)
+    {
+      aabb_min = aabb_min.cwiseMin(hull[i]);
+      aabb_max = aabb_max.cwiseMax(hull[i]);
+    }
+    EXPECT_LE(area, (aabb_max(0) - aabb_min(0)) * (aabb_max(1) - aabb_min(1)) + 1e-6);
+
+    // every vertex is inside the rectangle
+    Eigen::Vector2f v(-axis(1), axis(0));
+    for (size_t i = 0; i < hull.size(); ++i)
+    {
+      EXPECT_GE(axis.dot(hull[i]), min_corner(0) - 1e-5);
+      EXPECT_LE(axis.dot(hull[i]), max_corner(0) + 1e-5);
+      EXPECT_GE(v.dot(hull[i]), min_corner(1) - 1e-5);
+      EXPECT_LE(v.dot(hull[i]), max_corner(1) + 1e-5);
+    }
+  }
+}
+
+TEST(test_shape_extraction, min_area_rectangle_degenerate)
+{
+  Eigen::Vector2f axis, min_corner, max_corner;
+  std::vector<Eigen::Vector2f> hull;
+  EXPECT_FALSE(ubr1_grasping::minimumAreaRectangle(hull, axis, min_corner, max_corner));
+
+  // single point
+  hull.push_back(Eigen::Vector2f(0.1, 0.2));
+  ASSERT_TRUE(ubr1_grasping::minimumAreaRectangle(hull, axis, min_corner, max_corner));
+  EXPECT_FLOAT_EQ(0.0, (max_corner - min_corner).norm());
+
+  // line segment
+  hull.push_back(Eigen::Vector2f(0.1, 0.5));
+  ASSERT_TRUE(ubr1_grasping::minimumAreaRectangle(hull, axis, min_corner, max_corner));
+  EXPECT_NEAR(0.3, max_corner(0) - min_corner(0), 1e-6);
+  EXPECT_NEAR(0.0, max_corner(1) - min_corner(1), 1e-6);
+}
+
+TEST(test_shape_extraction, min_enclosing_circle_random_points)
+{
+  srand(3);
+  for (int trial = 0; trial < 100; ++trial)
+  {
+    std::vector<Eigen::Vector2f> points;
+    size_t size = 1 + rand() % 100;
+    for (size_t i = 0; i < size; ++i)
+      points.push_back(Eigen::Vector2f(randomFloat(-0.1, 0.1), randomFloat(0.3, 0.5)));
+
+    Eigen::Vector2f center;
+    float radius;
+    ASSERT_TRUE(ubr1_grasping::minimumEnclosingCircle(points, center, radius));
+
+    // encloses every point, with at least two on the boundary (or one point)
+    int on_boundary = 0;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      float distance = (points[i] - center).norm();
+      EXPECT_LE(distance, radius + 1e-5);
+      if (distance > radius - 1e-5)
+        ++on_boundary;
+    }
+    EXPECT_GE(on_boundary, std::min(2, static_cast<int>(points.size())));
+
+    // no larger than the best circle centered between two points
+    double pair_radius = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      for (size_t j = i; j < points.size(); ++j)
+      {
+        Eigen::Vector2f c = (points[i] + points[j]) / 2.0;
+        double r = 0.0;
+        for (size_t k = 0; k < points.size(); ++k)
+          r = std::max(r, static_cast<double>((points[k] - c).norm()));
+        pair_radius = std::min(pair_radius, r);
+      }
+    }
+    EXPECT_LE(radius, pair_radius + 1e-5);
+  }
+}
+
+TEST(test_shape_extraction, min_enclosing_circle_circle)
+{
+  // points on a circle, centered at (0.3, -0.2) with radius 0.04
+  std::vector<Eigen::Vector2f> points;
+  for (int i = 0; i < 360; i += 7)
+    points.push_back(Eigen::Vector2f(0.3 + 0.04 * cos(i * M_PI / 180.0),
+                                     -0.2 + 0.04 * sin(i * M_PI / 180.0)));
+
+  Eigen::Vector2f center;
+  float radius;
+  ASSERT_TRUE(ubr1_grasping::minimumEnclosingCircle(points, center, radius));
+  EXPECT_NEAR(0.3, center(0), 1e-5);
+  EXPECT_NEAR(-0.2, center(1), 1e-5);
+  EXPECT_NEAR(0.04, radius, 1e-5);
+
+  points.clear();
+  EXPECT_FALSE(ubr1_grasping::minimumEnclosingCircle(points, center, radius));
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
 {
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2014, Unbounded Robotics Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Unbounded Robotics, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Author: Michael Ferguson
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <limits>
+#include <algorithm>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include <gtest/gtest.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <ubr1_grasping/voxel_clustering.h>
+
+using ubr1_grasping::VoxelClustering;
+
+typedef pcl::PointCloud<pcl::PointXYZRGB> Cloud;
+
+void addPoint(Cloud& cloud, float x, float y, float z)
+{
+  pcl::PointXYZRGB p;
+  p.x = x;
+  p.y = y;
+  p.z = z;
+  cloud.points.push_back(p);
+  cloud.width = cloud.points.size();
+  cloud.height = 1;
+}
+
+// Uniform points in a box, and a few dense blobs
+Cloud::Ptr makeRandomCloud(unsigned int seed, size_t points, float size)
+{
+  boost::random::mt19937 rng(seed);
+  boost::random::uniform_real_distribution<float> uniform(0.0, size);
+  boost::random::uniform_real_distribution<float> blob(-0.02, 0.02);
+  Cloud::Ptr cloud(new Cloud);
+  for (size_t i = 0; i < points; ++i)
+    addPoint(*cloud, uniform(rng), uniform(rng), uniform(rng));
+  for (int b = 0; b < 5; ++b)
+  {
+    float x = uniform(rng), y = uniform(rng), z = uniform(rng);
+    for (size_t i = 0; i < points / 10; ++i)
+      addPoint(*cloud, x + blob(rng), y + blob(rng), z + blob(rng));
+  }
+  return cloud;
+}
+
+// Clusters as sorted lists of indices, so order of clusters does not matter
+std::vector<std::vector<int> > partition(const std::vector<pcl::PointIndices>& clusters)
+{
+  std::vector<std::vector<int> > sets;
+  for (size_t i = 0; i < clusters.size(); ++i)
+  {
+    sets.push_back(clusters[i].indices);
+    std::sort(sets.back().begin(), sets.back().end());
+  }
+  std::sort(sets.begin(), sets.end());
+  return sets;
+}
+
+// Cluster with both, and compare
+void expectSameClusters(const Cloud::ConstPtr& cloud, double tolerance, int min_size,
+                        const pcl::PointIndices::ConstPtr& indices = pcl::PointIndices::ConstPtr())
+{
+  pcl::EuclideanClusterExtraction<pcl::PointXYZRGB> kdtree_clustering;
+  kdtree_clustering.setClusterTolerance(tolerance);
+  kdtree_clustering.setMinClusterSize(min_size);
+  kdtree_clustering.setInputCloud(cloud);
+  if (indices)
+    kdtree_clustering.setIndices(indices);
+  std::vector<pcl::PointIndices> expected;
+  kdtree_clustering.extract(expected);
+
+  VoxelClustering voxel_clustering;
+  voxel_clustering.setClusterTolerance(tolerance);
+  voxel_clustering.setMinClusterSize(min_size);
+  voxel_clustering.setInputCloud(cloud);
+  if (indices)
+    voxel_clustering.setIndices(indices);
+  std::vector<pcl::PointIndices> clusters;
+  voxel_clustering.extract(clusters);
+
+  EXPECT_EQ(expected.size(), clusters.size()) << "tolerance " << tolerance << ", min size " << min_size;
+  EXPECT_TRUE(partition(expected) == partition(clusters)) << "tolerance " << tolerance << ", min size " << min_size;
+
+  // Both sorted by decreasing size
+  for (size_t i = 1; i < clusters.size(); ++i)
+    EXPECT_GE(clusters[i - 1].indices.size(), clusters[i].indices.size());
+}
+
+TEST(VoxelClusteringTests, test_random_clouds)
+{
+  for (unsigned int seed = 0; seed < 5; ++seed)
+  {
+    Cloud::Ptr cloud = makeRandomCloud(seed, 4000, 0.5);
+    expectSameClusters(cloud, 0.01, 1);
+    expectSameClusters(cloud, 0.02, 1);
+    expectSameClusters(cloud, 0.02, 20);
+  }
+}
+
+TEST(VoxelClusteringTests, test_voxelized_clouds)
+{
+  for (unsigned int seed = 0; seed < 5; ++seed)
+  {
+    Cloud::Ptr cloud = makeRandomCloud(seed, 20000, 0.3);
+    Cloud::Ptr voxelized(new Cloud);
+    pcl::VoxelGrid<pcl::PointXYZRGB> voxel_grid;
+    voxel_grid.setLeafSize(0.005f, 0.005f, 0.005f);
+    voxel_grid.setInputCloud(cloud);
+    voxel_grid.filter(*voxelized);
+    expectSameClusters(voxelized, 0.01, 1);
+    expectSameClusters(voxelized, 0.01, 50);
+  }
+}
+
+TEST(VoxelClusteringTests, test_indices)
+{
+  Cloud::Ptr cloud = makeRandomCloud(11, 4000, 0.5);
+  pcl::PointIndices::Ptr indices(new pcl::PointIndices);
+  for (size_t i = 0; i < cloud->points.size(); i += 3)
+    indices->indices.push_back(i);
+  expectSameClusters(cloud, 0.02, 1, indices);
+}
+
+TEST(VoxelClusteringTests, test_exactly_at_tolerance)
+{
+  // Powers of two, so that distances are exact in float
+  const double tolerance = 1.0 / 128.0;
+  Cloud::Ptr cloud(new Cloud);
+
+  // Points exactly tolerance apart along each axis are not neighbors
+  for (int i = 0; i < 10; ++i)
+    addPoint(*cloud, i * tolerance, 0.0, 0.0);
+  for (int i = 0; i < 10; ++i)
+    addPoint(*cloud, 1.0, 1.0 + i * tolerance, -1.0);
+  for (int i = 0; i < 10; ++i)
+    addPoint(*cloud, -1.0, 0.5, 0.5 + i * tolerance);
+
+  // Points just inside tolerance are
+  const float inside = tolerance * (1.0 - 1.0 / 1024.0);
+  for (int i = 0; i < 10; ++i)
+    addPoint(*cloud, -2.0 + i * inside, -2.0, -2.0);
+
+  expectSameClusters(cloud, tolerance, 1);
+
+  VoxelClustering voxel_clustering;
+  voxel_clustering.setClusterTolerance(tolerance);
+  voxel_clustering.setInputCloud(cloud);
+  std::vector<pcl::PointIndices> clusters;
+  voxel_clustering.extract(clusters);
+  ASSERT_EQ(31, clusters.size());
+  EXPECT_EQ(10, clusters[0].indices.size());
+
+  // Diagonally, steps of (3, 4) with a tolerance of 5 are exactly at tolerance
+  Cloud::Ptr diagonal(new Cloud);
+  for (int i = 0; i < 10; ++i)
+    addPoint(*diagonal, 2.0 + i * 3.0 / 1024.0, 2.0 + i * 4.0 / 1024.0, 2.0);
+  expectSameClusters(diagonal, 5.0 / 1024.0, 1);
+  voxel_clustering.setClusterTolerance(5.0 / 1024.0);
+  voxel_clustering.setInputCloud(diagonal);
+  voxel_clustering.extract(clusters);
+  EXPECT_EQ(10, clusters.size());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -39,10 +39,12 @@
 
 #include <string>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
 
 #include <ros/ros.h>
 #include <ubr_controllers/controller.h>
 #include <ubr_controllers/joint_handle.h>
+#include <ubr_controllers/odometry_history.h>
 #include <tf/transform_broadcaster.h>
 
 #include <geometry_msgs/Twist.h>
@@ -73,7 +75,14 @@ public:
     left_last_timestamp_ = right_last_timestamp_ = 0.0;
     last_command_ = last_update_ = ros::Time(0.0);
   }
-  virtual ~BaseController() {}
+  virtual ~BaseController()
+  {
+    if (publish_thread_)
+    {
+      publish_thread_->interrupt();
+      publish_thread_->join();
+    }
+  }
 
   /**
    *  \brief Initialize parameters, interfaces
@@ -125,14 +134,42 @@ public:
    */
   void command(const geometry_msgs::TwistConstPtr& msg);
 
-  /** \brief Publish odom, possibly tf */
+  /**
+   *  \brief Publish odom, possibly tf, at a time within the odometry
+   *         history. Odom is normally published by the internal publishing
+   *         thread, this is safe to call from any thread.
+   *  \returns false if time is outside of the history.
+   */
   bool publish(ros::Time time);
 
+  /**
+   *  \brief Get the odometry of the base at some time in the recent past.
+   *  \param time The time to query, must be within the history.
+   *  \param sample The returned pose and velocity of the base.
+   *  \returns false if time is outside of the history.
+   */
+  bool poseAt(const ros::Time& time, OdometrySample& sample) const
+  {
+    return history_.poseAt(time, sample);
+  }
+
+  /** \brief Get the odometry history, written on every update. */
+  const OdometryHistory& getOdometryHistory() const
+  {
+    return history_;
+  }
+
 private:
   bool initialized_;
 
   void updateCallback(const ros::WallTimerEvent& event);
 
+  // Publishes odom and tf from the odometry history, off the update thread
+  void publishThread();
+
+  // Publish odom and tf for a sample, stamped with the time it was measured
+  void publishSample(const OdometrySample& sample);
+
   // Set base wheel speeds in m/s
   void setCommand(float left, float right);
 
@@ -168,11 +205,14 @@ private:
   ros::Duration timeout_;
 
   nav_msgs::Odometry odom_;
+  OdometryHistory history_;
   ros::Publisher odom_pub_;
   ros::Subscriber cmd_sub_;
 
   boost::shared_ptr<tf::TransformBroadcaster> broadcaster_;
   bool publish_tf_;
+  double publish_rate_;
+  boost::shared_ptr<boost::thread> publish_thread_;
 
   std::string odometry_frame_;
   std::string base_frame_;
@@ -61,6 +61,16 @@ public:
     loader_("ubr_controllers", "ubr_controllers::Controller")
   {
   }
+
+  /**
+   *  \brief Create a manager whose controllers are loaded relative to a
+   *         namespace, for instance when simulating several robots.
+   */
+  explicit ControllerManager(const ros::NodeHandle& root_nh) :
+    root_nh_(root_nh),
+    loader_("ubr_controllers", "ubr_controllers::Controller")
+  {
+  }
   virtual ~ControllerManager()
   {
   }
@@ -92,6 +102,7 @@ public:
     }
 
     update_service_ = nh.advertiseService("update_controllers", &ControllerManager::updateCallback, this);
+    return true;
   }
 
   /**
@@ -201,7 +212,7 @@ public:
   {
     boost::recursive_mutex::scoped_lock lock(update_lock_);
 
-    ros::NodeHandle nh(name);
+    ros::NodeHandle nh(root_nh_, name);
 
     std::string type;
     if (nh.getParam("type", type))
@@ -285,6 +296,9 @@ protected:
     return true;
   }
 
+  /// Controllers are loaded relative to this namespace
+  ros::NodeHandle root_nh_;
+
   boost::recursive_mutex update_lock_;
   pluginlib::ClassLoader<ubr_controllers::Controller> loader_;
   std::vector< boost::shared_ptr<ubr_controllers::Controller> > controllers_;
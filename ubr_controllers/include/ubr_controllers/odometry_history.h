@@ -0,0 +1,245 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Author: Michael Ferguson
+
+#ifndef UBR_CONTROLLERS_ODOMETRY_HISTORY_H_
+#define UBR_CONTROLLERS_ODOMETRY_HISTORY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <ros/ros.h>
+#include <angles/angles.h>
+
+namespace ubr_controllers
+{
+
+/**
+ *  \brief A single timestamped sample of planar base odometry.
+ */
+struct OdometrySample
+{
+  ros::Time stamp;
+  double x;
+  double y;
+  double theta;
+  /// forward velocity, in m/s
+  double dx;
+  /// rotational velocity, in rad/s
+  double dr;
+
+  OdometrySample() : x(0.0), y(0.0), theta(0.0), dx(0.0), dr(0.0) {}
+};
+
+/**
+ *  \brief Integrate a differential drive step of d meters forward and th
+ *         radians of rotation along the exact arc.
+ */
+inline void integrateArc(double d, double th, double& x, double& y, double& theta)
+{
+  if (fabs(th) < 1e-6)
+  {
+    // Arc degenerates to a line, use a second-order (midpoint) step
+    double mid = theta + th/2.0;
+    x += d*cos(mid);
+    y += d*sin(mid);
+  }
+  else
+  {
+    double r = d/th;
+    x += r*(sin(theta + th) - sin(theta));
+    y -= r*(cos(theta + th) - cos(theta));
+  }
+  theta += th;
+}
+
+/**
+ *  \brief Fixed size ring of odometry samples. There must be only a single
+ *         writer (the controller update), which never blocks. Any number
+ *         of readers may query, from any thread -- a reader that races
+ *         with the writer on a slot will see the slot as invalid rather
+ *         than reading a torn sample.
+ */
+class OdometryHistory
+{
+  struct Slot
+  {
+    /// 0 while being written, otherwise index of sample + 1
+    boost::atomic<boost::uint64_t> version;
+    OdometrySample sample;
+
+    Slot() : version(0) {}
+  };
+
+public:
+  explicit OdometryHistory(size_t capacity = 1024) :
+    head_(0),
+    oldest_(0)
+  {
+    resize(capacity);
+  }
+
+  /**
+   *  \brief Resize the history, discarding all samples. This is NOT
+   *         thread-safe, call only before writer and readers start.
+   */
+  void resize(size_t capacity)
+  {
+    size_ = (capacity < 2) ? 2 : capacity;
+    slots_.reset(new Slot[size_]);
+    head_.store(0);
+    oldest_.store(0);
+  }
+
+  /** \brief Get the maximum number of samples held. */
+  size_t capacity() const
+  {
+    return size_;
+  }
+
+  /**
+   *  \brief Add a new sample. If the stamp is before the last sample, such
+   *         as after a simulation reset, all older samples are discarded.
+   */
+  void push(const OdometrySample& sample)
+  {
+    boost::uint64_t index = head_.load(boost::memory_order_relaxed);
+    if (index > 0 && sample.stamp < last_stamp_)
+      oldest_.store(index, boost::memory_order_release);
+    last_stamp_ = sample.stamp;
+    Slot& slot = slots_[index % size_];
+    slot.version.store(0, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    slot.sample = sample;
+    slot.version.store(index + 1, boost::memory_order_release);
+    head_.store(index + 1, boost::memory_order_release);
+  }
+
+  /** \brief Get the most recent sample, false if history is empty. */
+  bool latest(OdometrySample& sample) const
+  {
+    boost::uint64_t head = head_.load(boost::memory_order_acquire);
+    if (head == 0)
+      return false;
+    return read(head - 1, sample);
+  }
+
+  /**
+   *  \brief Get the pose of the base at a given time, interpolating between
+   *         the bracketing samples.
+   *  \param time The time to query.
+   *  \param sample The returned sample, stamped with time.
+   *  \returns false if time is outside of the history.
+   */
+  bool poseAt(const ros::Time& time, OdometrySample& sample) const
+  {
+    boost::uint64_t head = head_.load(boost::memory_order_acquire);
+    if (head == 0)
+      return false;
+
+    // Leave one slot of slack, the writer may be overwriting the oldest
+    boost::uint64_t lo = (head > size_ - 1) ? head - (size_ - 1) : 0;
+    lo = std::max(lo, oldest_.load(boost::memory_order_acquire));
+    boost::uint64_t hi = head - 1;
+    if (lo > hi)
+      return false;  // history was cleared while reading
+
+    OdometrySample lower, upper;
+    if (!read(lo, lower) || !read(hi, upper))
+      return false;
+    if (time < lower.stamp || time > upper.stamp)
+      return false;
+
+    // Binary search for samples bracketing time
+    while (hi - lo > 1)
+    {
+      boost::uint64_t mid = lo + (hi - lo)/2;
+      OdometrySample s;
+      if (!read(mid, s))
+        return false;
+      if (s.stamp <= time)
+      {
+        lo = mid;
+        lower = s;
+      }
+      else
+      {
+        hi = mid;
+        upper = s;
+      }
+    }
+
+    double span = (upper.stamp - lower.stamp).toSec();
+    double t = (span > 0.0) ? (time - lower.stamp).toSec() / span : 0.0;
+    sample.stamp = time;
+    sample.x = lower.x + t * (upper.x - lower.x);
+    sample.y = lower.y + t * (upper.y - lower.y);
+    sample.theta = lower.theta + t * angles::shortest_angular_distance(lower.theta, upper.theta);
+    sample.dx = lower.dx + t * (upper.dx - lower.dx);
+    sample.dr = lower.dr + t * (upper.dr - lower.dr);
+    return true;
+  }
+
+private:
+  /** \brief Read a sample by index, false if it was overwritten. */
+  bool read(boost::uint64_t index, OdometrySample& sample) const
+  {
+    const Slot& slot = slots_[index % size_];
+    if (slot.version.load(boost::memory_order_acquire) != index + 1)
+      return false;
+    sample = slot.sample;
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    return slot.version.load(boost::memory_order_relaxed) == index + 1;
+  }
+
+  boost::scoped_array<Slot> slots_;
+  size_t size_;
+  boost::atomic<boost::uint64_t> head_;
+  /// index of the first sample since stamps last went backwards
+  boost::atomic<boost::uint64_t> oldest_;
+  /// stamp of the last sample pushed, only used by the writer
+  ros::Time last_stamp_;
+
+  // You no copy...
+  OdometryHistory(const OdometryHistory&);
+  OdometryHistory& operator=(const OdometryHistory&);
+};
+
+}  // namespace ubr_controllers
+
+#endif  // UBR_CONTROLLERS_ODOMETRY_HISTORY_H_
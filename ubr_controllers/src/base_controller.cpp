@@ -71,9 +71,27 @@ bool BaseController::init(ros::NodeHandle& nh, ControllerManager* manager)
   nh.param<double>("track_width", track_width_, 0.33665);
   nh.param<double>("radians_per_meter", radians_per_meter_, 17.4978147374);
   nh.param<bool>("publish_tf", publish_tf_, true);
+  nh.param<double>("publish_rate", publish_rate_, 100.0);
   nh.param<std::string>("odometry_frame", odometry_frame_, "odom");
   nh.param<std::string>("base_frame", base_frame_, "base_link");
   nh.param<double>("moving_threshold", moving_threshold_, 0.0001);
+  if (publish_rate_ <= 0.0)
+  {
+    ROS_ERROR_NAMED("BaseController", "publish_rate must be positive.");
+    initialized_ = false;
+    return false;
+  }
+
+  /* Size of odometry history, default is ~10 seconds at 1khz */
+  int history_size;
+  nh.param<int>("history_size", history_size, 10000);
+  if (history_size < 2)
+  {
+    ROS_ERROR_NAMED("BaseController", "history_size must be at least 2.");
+    initialized_ = false;
+    return false;
+  }
+  history_.resize(history_size);
 
   double t;
   nh.param<double>("/timeout", t, 0.25);
@@ -89,11 +107,12 @@ bool BaseController::init(ros::NodeHandle& nh, ControllerManager* manager)
   cmd_sub_ = nh.subscribe<geometry_msgs::Twist>("command", 1,
                 boost::bind(&BaseController::command, this, _1));
 
-  /* Publish odometry & tf */
-  ros::NodeHandle n;
+  /* Publish odometry & tf, in the namespace of the controller manager */
+  ros::NodeHandle n(ros::names::parentNamespace(nh.getNamespace()));
   odom_pub_ = n.advertise<nav_msgs::Odometry>("odom", 10);
   if (publish_tf_)
     broadcaster_.reset(new tf::TransformBroadcaster());
+  publish_thread_.reset(new boost::thread(&BaseController::publishThread, this));
 
   initialized_ = true;
   return initialized_;
@@ -203,10 +222,8 @@ bool BaseController::update(const ros::Time now, const ros::Duration dt)
   dx = (left_vel + right_vel)/2.0;
   dr = (right_vel - left_vel)/track_width_;
 
-  /* Update store odometry */
-  odom_.pose.pose.position.x += d*cos(theta_);
-  odom_.pose.pose.position.y += d*sin(theta_);
-  theta_ += th;
+  /* Update store odometry, integrating along the arc traveled */
+  integrateArc(d, th, odom_.pose.pose.position.x, odom_.pose.pose.position.y, theta_);
 
   /* Actually set command */
   if ((last_sent_x_ != 0.0) || (last_sent_r_ != 0.0) ||
@@ -222,32 +239,120 @@ bool BaseController::update(const ros::Time now, const ros::Duration dt)
   odom_.twist.twist.linear.x = dx;
   odom_.twist.twist.angular.z = dr;
 
+  /* Record odometry history */
+  OdometrySample sample;
+  sample.stamp = now;
+  sample.x = odom_.pose.pose.position.x;
+  sample.y = odom_.pose.pose.position.y;
+  sample.theta = theta_;
+  sample.dx = dx;
+  sample.dr = dr;
+  history_.push(sample);
+
   last_update_ = now;
   return true;
 }
 
 bool BaseController::publish(ros::Time time)
 {
-  /* publish or perish */
-  odom_.header.stamp = time;
-  odom_pub_.publish(odom_);
+  OdometrySample sample;
+  if (!history_.poseAt(time, sample))
+    return false;
+  publishSample(sample);
+  return true;
+}
+
+void BaseController::publishSample(const OdometrySample& sample)
+{
+  /* publish or perish, stamped with the time of the measurement */
+  nav_msgs::OdometryPtr odom(new nav_msgs::Odometry());
+  odom->header.stamp = sample.stamp;
+  odom->header.frame_id = odometry_frame_;
+  odom->child_frame_id = base_frame_;
+  odom->pose.pose.position.x = sample.x;
+  odom->pose.pose.position.y = sample.y;
+  odom->pose.pose.orientation.z = sin(sample.theta/2.0);
+  odom->pose.pose.orientation.w = cos(sample.theta/2.0);
+  odom->twist.twist.linear.x = sample.dx;
+  odom->twist.twist.angular.z = sample.dr;
+  odom_pub_.publish(odom);
 
   if (publish_tf_)
   {
     tf::Transform transform;
-    transform.setOrigin(tf::Vector3(odom_.pose.pose.position.x, odom_.pose.pose.position.y, 0.0));
-    transform.setRotation(tf::Quaternion(odom_.pose.pose.orientation.x,
-                                         odom_.pose.pose.orientation.y,
-                                         odom_.pose.pose.orientation.z,
-                                         odom_.pose.pose.orientation.w) );
+    transform.setOrigin(tf::Vector3(sample.x, sample.y, 0.0));
+    transform.setRotation(tf::createQuaternionFromYaw(sample.theta));
     /*
      * REP105 (http://ros.org/reps/rep-0105.html)
      *   says: map -> odom -> base_link
      */
-    broadcaster_->sendTransform(tf::StampedTransform(transform, time, odometry_frame_, base_frame_));
+    broadcaster_->sendTransform(tf::StampedTransform(transform, sample.stamp, odometry_frame_, base_frame_));
   }
+}
 
-  return true;
+void BaseController::publishThread()
+{
+  /*
+   * Paced in ROS time, so that a simulation running faster than real
+   * time still gets publish_rate messages per simulated second. Sleeps
+   * are short and interruptible, ros::Rate would block shutdown while
+   * simulated time is paused.
+   */
+  ros::Duration period(1.0/publish_rate_);
+  ros::Time next = ros::Time::now();
+  ros::Time last_stamp;
+  try
+  {
+    while (ros::ok())
+    {
+      boost::this_thread::interruption_point();
+
+      ros::Time now = ros::Time::now();
+      if (now + period < next)
+      {
+        /* time went backwards, as on a simulation reset */
+        next = now;
+        last_stamp = ros::Time();
+      }
+
+      if (now >= next)
+      {
+        OdometrySample sample;
+        bool have_sample = history_.latest(sample);
+        if (have_sample && sample.stamp > last_stamp)
+        {
+          publishSample(sample);
+          last_stamp = sample.stamp;
+        }
+        else if (now > last_stamp && (!have_sample || now - sample.stamp > period))
+        {
+          /*
+           * update() only runs while this controller is active, which is
+           * not until the first command. If it has not run for a period,
+           * odometry is not being integrated, so republish the last pose (or the origin, before
+           * any update) at the current time, stopped. Stamps only ever
+           * increase, so tf does not drop the transform as old data.
+           */
+          sample.stamp = now;
+          sample.dx = sample.dr = 0.0;
+          publishSample(sample);
+          last_stamp = now;
+        }
+        next += period;
+        if (next < now)
+          next = now + period;  // fell behind, do not try to catch up
+      }
+
+      double remaining = (next - ros::Time::now()).toSec();
+      if (ros::Time::isSimTime())
+        remaining = std::min(remaining, 0.001);
+      if (remaining > 0.0)
+        boost::this_thread::sleep(boost::posix_time::microseconds(static_cast<long>(remaining * 1e6)));
+    }
+  }
+  catch (boost::thread_interrupted&)
+  {
+  }
 }
 
 void BaseController::setCommand(float left, float right)
@@ -0,0 +1,154 @@
+/*********************************************************************
+ *  Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2014, Unbounded Robotics Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Unbounded Robotics nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+// Author: Michael Ferguson
+
+#include <gtest/gtest.h>
+#include <ubr_controllers/odometry_history.h>
+
+using ubr_controllers::OdometryHistory;
+using ubr_controllers::OdometrySample;
+
+// Sample at time t of a base driving along x at 1 m/s, turning at 1 rad/s
+OdometrySample makeSample(double t)
+{
+  OdometrySample s;
+  s.stamp = ros::Time(100.0 + t);
+  s.x = t;
+  s.y = 2.0 * t;
+  s.theta = angles::normalize_angle(t);
+  s.dx = 1.0;
+  s.dr = 1.0;
+  return s;
+}
+
+TEST(OdometryHistoryTests, test_empty)
+{
+  OdometryHistory history(10);
+  OdometrySample s;
+  EXPECT_FALSE(history.latest(s));
+  EXPECT_FALSE(history.poseAt(ros::Time(100.0), s));
+}
+
+TEST(OdometryHistoryTests, test_interpolation)
+{
+  OdometryHistory history(100);
+  for (int i = 0; i < 50; ++i)
+    history.push(makeSample(i * 0.1));
+
+  OdometrySample s;
+  ASSERT_TRUE(history.latest(s));
+  EXPECT_DOUBLE_EQ(4.9, s.x);
+
+  // Exactly on a sample
+  ASSERT_TRUE(history.poseAt(ros::Time(101.0), s));
+  EXPECT_NEAR(1.0, s.x, 1e-6);
+  EXPECT_NEAR(2.0, s.y, 1e-6);
+
+  // Between samples, found by the binary search
+  ASSERT_TRUE(history.poseAt(ros::Time(102.34), s));
+  EXPECT_NEAR(2.34, s.x, 1e-6);
+  EXPECT_NEAR(4.68, s.y, 1e-6);
+  EXPECT_NEAR(2.34, s.theta, 1e-6);
+  EXPECT_EQ(ros::Time(102.34), s.stamp);
+
+  // First and last samples are inside the history
+  EXPECT_TRUE(history.poseAt(ros::Time(100.0), s));
+  EXPECT_TRUE(history.poseAt(ros::Time(104.9), s));
+
+  // Before the oldest and after the newest are not
+  EXPECT_FALSE(history.poseAt(ros::Time(99.99), s));
+  EXPECT_FALSE(history.poseAt(ros::Time(104.91), s));
+}
+
+TEST(OdometryHistoryTests, test_angle_wrap)
+{
+  OdometryHistory history(10);
+  OdometrySample a, b, s;
+  a.stamp = ros::Time(1.0);
+  a.theta = 3.0;
+  b.stamp = ros::Time(2.0);
+  b.theta = -3.0;  // crossed pi going counter-clockwise
+  history.push(a);
+  history.push(b);
+
+  ASSERT_TRUE(history.poseAt(ros::Time(1.5), s));
+  EXPECT_NEAR(M_PI, fabs(angles::normalize_angle(s.theta)), 1e-6);
+}
+
+TEST(OdometryHistoryTests, test_ring_wrap)
+{
+  OdometryHistory history(16);
+  for (int i = 0; i < 100; ++i)
+    history.push(makeSample(i * 0.1));
+
+  // Only the newest samples remain, less one slot of slack
+  OdometrySample s;
+  EXPECT_FALSE(history.poseAt(ros::Time(108.0), s));
+  EXPECT_FALSE(history.poseAt(ros::Time(108.45), s));
+  ASSERT_TRUE(history.poseAt(ros::Time(108.55), s));
+  EXPECT_NEAR(8.55, s.x, 1e-6);
+  ASSERT_TRUE(history.poseAt(ros::Time(109.9), s));
+  EXPECT_NEAR(9.9, s.x, 1e-6);
+}
+
+TEST(OdometryHistoryTests, test_time_reset)
+{
+  OdometryHistory history(100);
+  for (int i = 0; i < 20; ++i)
+    history.push(makeSample(i * 0.1));
+
+  // Time goes backwards, as when a simulation is reset
+  OdometrySample s = makeSample(0.0);
+  s.stamp = ros::Time(50.0);
+  history.push(s);
+  s.stamp = ros::Time(51.0);
+  s.x = 1.0;
+  history.push(s);
+
+  // Samples from before the reset are gone
+  OdometrySample result;
+  EXPECT_FALSE(history.poseAt(ros::Time(101.0), result));
+  ASSERT_TRUE(history.poseAt(ros::Time(50.5), result));
+  EXPECT_NEAR(0.5, result.x, 1e-6);
+  ASSERT_TRUE(history.latest(result));
+  EXPECT_EQ(ros::Time(51.0), result.stamp);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}